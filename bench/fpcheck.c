@@ -0,0 +1,151 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "fpcheck.h"
+#include "lib/lexer.h"
+#include "lib/source.h"
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Longest constant generated, with room for its padding
+#define FPCHECK_MAX 1024
+#define FPCHECK_SHOWN 10
+
+enum fp_kind {
+    FpDecimal = 0, // Up to 19 digits, exponents past both ends of binary64
+    FpHex,         // Up to 16 hex digits with a binary exponent
+    FpHalfway,     // Right at or next to the middle of two doubles
+    FpLong,        // Hundreds of digits, where the slow path decides
+    FpKinds,
+};
+
+// xorshift64, enough to vary the constants
+uint64_t fp_random(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+size_t fp_range(uint64_t *state, size_t low, size_t high) {
+    return low + fp_random(state) % (high - low + 1);
+}
+
+// `count` random digits of `base` into `out`, with a '.' somewhere maybe
+size_t fp_digits(uint64_t *state, char *out, size_t count, int base) {
+    static const char digits[] = "0123456789abcdef";
+    size_t len = 0, dot = fp_range(state, 0, count + 4);
+    for (size_t i = 0; i < count; i++) {
+        if (i == dot) {
+            out[len++] = '.';
+        }
+        out[len++] = digits[fp_random(state) % base];
+    }
+    // Neither a '.' nor an exponent would leave an integer constant
+    if (dot >= count) {
+        out[len++] = '.';
+    }
+    return len;
+}
+
+// Decimal spelling of the middle of a random double and the next one,
+// nudged a unit in its last digit up, down or not at all
+size_t fp_halfway(uint64_t *state, char *out) {
+    double low;
+    uint64_t bits = fp_random(state) % 0x7FEFFFFFFFFFFFFFull;
+    memcpy(&low, &bits, sizeof(low));
+    long double mid = ((long double)low + nextafter(low, INFINITY)) / 2;
+    size_t len = snprintf(out, FPCHECK_MAX, "%.*Le", LDBL_DIG + 8, mid);
+
+    char *e = strchr(out, 'e');
+    int nudge = fp_range(state, 0, 2);
+    if (e && nudge == 1 && e[-1] < '9') {
+        e[-1] += 1;
+    } else if (e && nudge == 2 && e[-1] > '0') {
+        e[-1] -= 1;
+    }
+    return len;
+}
+
+size_t fp_constant(uint64_t *state, enum fp_kind kind, char *out) {
+    size_t len = 0;
+    switch (kind) {
+    case FpDecimal:
+        len = fp_digits(state, out, fp_range(state, 1, 19), 10);
+        return len + sprintf(out + len, "e%d", (int)fp_range(state, 0, 660) -
+                                                   345);
+    case FpHex:
+        len = sprintf(out, "0x");
+        len += fp_digits(state, out + len, fp_range(state, 1, 16), 16);
+        return len + sprintf(out + len, "p%d", (int)fp_range(state, 0, 2200) -
+                                                   1140);
+    case FpHalfway:
+        return fp_halfway(state, out);
+    default:
+        len = fp_digits(state, out, fp_range(state, 20, 780), 10);
+        return len + sprintf(out + len, "e%d", (int)fp_range(state, 0, 720) -
+                                                   400);
+    }
+}
+
+// The bits strtod should give for `text`.
+// glibc's strtod rounds some hexadecimal subnormals the wrong way, so those
+// are read exactly into a long double first and rounded once from there.
+uint64_t fp_expected(enum fp_kind kind, const char *text) {
+    double value = kind == FpHex && LDBL_MANT_DIG >= 64
+                       ? (double)strtold(text, 0)
+                       : strtod(text, 0);
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+size_t check_floats(size_t count) {
+    Ids *id_table = create_ids(8);
+    Literals *literals = create_literals(8);
+    Constants *constants = create_constants(8);
+    char text[FPCHECK_MAX + 1 + SOURCE_PADDING];
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+
+    size_t differ = 0;
+    for (size_t i = 0; i < count; i++) {
+        enum fp_kind kind = i % FpKinds;
+        if (kind == FpHalfway && LDBL_MANT_DIG < 64) {
+            // Without a wider long double the middle cannot be spelled
+            kind = FpLong;
+        }
+        size_t len = fp_constant(&state, kind, text);
+        text[len] = '\n';
+        memset(text + len + 1, 0, SOURCE_PADDING);
+
+        Stream stream = {.start = text, .len = len, .base = 1};
+        reset_vec(constants->bits);
+        Lex lex = lex_next(&stream, id_table, literals, constants);
+        uint64_t got = lex.type == LEX_ConstantDouble
+                           ? get_constant(constants, lex.id)
+                           : 0;
+
+        text[len] = '\0';
+        uint64_t expected = fp_expected(kind, text);
+        if (lex.type != LEX_ConstantDouble || lex.span.len != len ||
+            got != expected) {
+            if (differ < FPCHECK_SHOWN) {
+                printf("%.60s%s: lexed %016llx, strtod %016llx\n", text,
+                       len > 60 ? "..." : "", (unsigned long long)got,
+                       (unsigned long long)expected);
+            }
+            differ += 1;
+        }
+    }
+    printf("floats: %zu checked against strtod, %zu differ\n", count, differ);
+
+    delete_ids(id_table);
+    delete_literals(literals);
+    delete_constants(constants);
+    return differ;
+}
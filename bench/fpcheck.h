@@ -0,0 +1,19 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef FPCHECK_H_
+#define FPCHECK_H_
+
+#include <stddef.h>
+
+// Differential test of floating constants against strtod.
+// Random decimal, hexadecimal, near halfway and long constants are lexed
+// one at a time, and the bits of each LEX_ConstantDouble are compared with
+// what strtod gives for the same text. They are made from a fixed seed, so
+// every run checks the same constants.
+
+// Check `count` constants, printing the first few that differ.
+// Returns how many differ.
+size_t check_floats(size_t count);
+
+#endif // FPCHECK_H_
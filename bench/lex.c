@@ -0,0 +1,391 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "fpcheck.h"
+#include "lib/lexer.h"
+#include "lib/parlex.h"
+#include "lib/source.h"
+#include "synth.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Lexer throughput benchmark
+// Every input is lexed `iters` times with fresh id, literal and
+// constant tables per run.
+// Files are spliced first, like the preprocessor does, but not timed.
+// With -g, generated inputs of about MB megabytes each are lexed after the
+// files, see synth.h.
+// With -t, whole inputs are lexed by lex_file into a reused token buffer.
+// With -j, they are lexed by lex_file_parallel on 1 up to THREADS threads,
+// a line for each, to see how it scales. The tokens and tables of each are
+// checked against lex_file, failing the run if any differ.
+// With -k, each input is lexed once more by lex_next, timing every token
+// to break the cycles down by kind of token. Skipping whitespace and
+// comments is counted in the token after them, and timing adds some cycles
+// to each, so compare these between runs rather than with the totals.
+// With -c, results are printed as CSV, one row per input, run and kind,
+// to keep and compare between commits.
+// With -f, COUNT floating constants are lexed and checked against strtod
+// instead of timing anything, see fpcheck.h.
+// Usage: dfcc-bench [-n ITERS] [-t] [-j THREADS] [-k] [-c] [-g MB] FILE...
+//        dfcc-bench -f COUNT
+
+#define CSV_HEADER                                                         \
+    "input,mode,threads,kind,bytes,tokens,seconds,mb_per_s,tokens_per_s," \
+    "cycles_per_token"
+
+enum token_class {
+    ClassIdentifier = 0,
+    ClassKeyword,
+    ClassInteger,
+    ClassFloating,
+    ClassChar,
+    ClassString,
+    ClassPunctuator,
+    ClassDirective,
+    ClassOther, // Comments and invalid tokens
+    Classes,
+};
+
+const char *const class_names[Classes] = {
+    [ClassIdentifier] = "identifier", [ClassKeyword] = "keyword",
+    [ClassInteger] = "integer",       [ClassFloating] = "floating",
+    [ClassChar] = "char",             [ClassString] = "string",
+    [ClassPunctuator] = "punctuator", [ClassDirective] = "directive",
+    [ClassOther] = "other",
+};
+
+enum token_class token_class(enum lex_type type) {
+    if (type == LEX_Identifier) {
+        return ClassIdentifier;
+    } else if (type == LEX_Keyword) {
+        return ClassKeyword;
+    } else if (type >= LEX_ConstantUnsignedLongLong && type <= LEX_Constant) {
+        return ClassInteger;
+    } else if (type >= LEX_ConstantFloat && type <= LEX_ConstantDecimal128) {
+        return ClassFloating;
+    } else if (type >= LEX_ConstantChar && type <= LEX_ConstantCharWide) {
+        return ClassChar;
+    } else if (type >= LEX_String && type <= LEX_StringWide) {
+        return ClassString;
+    } else if (type >= LEX_LBracket) {
+        return ClassPunctuator;
+    } else if (type == LEX_MacroToken || type == LEX_MacroEndToken) {
+        return ClassDirective;
+    }
+    return ClassOther;
+}
+
+// Tokens of one kind, with their text and time
+typedef struct ClassStats {
+    size_t tokens;
+    size_t bytes;
+    uint64_t cycles;
+} ClassStats;
+
+typedef struct Bench {
+    size_t iters;
+    size_t threads;
+    Tokens *buffer; // Set by -t and -j
+    int classes;
+    int csv;
+    size_t mismatches; // Runs of lex_file_parallel unlike lex_file
+
+    size_t total_bytes;
+    size_t total_tokens;
+    double total_time;
+    uint64_t total_cycles;
+} Bench;
+
+double now_sec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Time stamp counter where there is one, else nanoseconds
+uint64_t now_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return now_sec() * 1e9;
+#endif
+}
+
+size_t lex_all(char *buf, size_t len, Tokens *buffer, size_t threads) {
+    Stream stream = {.start = buf, .len = len, .base = 1};
+    Ids *id_table = create_ids(8);
+    Literals *literals = create_literals(8);
+    Constants *constants = create_constants(8);
+    size_t tokens = 0;
+    if (buffer && threads) {
+        lex_file_parallel(&stream, id_table, literals, constants, buffer,
+                          threads);
+        tokens = buffer->length - 1;
+    } else if (buffer) {
+        lex_file(&stream, id_table, literals, constants, buffer);
+        tokens = buffer->length - 1;
+    } else {
+        while (lex_next(&stream, id_table, literals, constants).type !=
+               LEX_Eof) {
+            tokens += 1;
+        }
+    }
+    delete_ids(id_table);
+    delete_literals(literals);
+    delete_constants(constants);
+    return tokens;
+}
+
+// A stream lexed by lex_file or lex_file_parallel, with its tables
+typedef struct Lexed {
+    Ids *id_table;
+    Literals *literals;
+    Constants *constants;
+    Tokens *tokens;
+} Lexed;
+
+Lexed lex_tables(char *buf, size_t len, size_t threads) {
+    Stream stream = {.start = buf, .len = len, .base = 1};
+    Lexed lexed = {create_ids(8), create_literals(8), create_constants(8),
+                   create_tokens(1024)};
+    if (threads) {
+        lex_file_parallel(&stream, lexed.id_table, lexed.literals,
+                          lexed.constants, lexed.tokens, threads);
+    } else {
+        lex_file(&stream, lexed.id_table, lexed.literals, lexed.constants,
+                 lexed.tokens);
+    }
+    return lexed;
+}
+
+void delete_lexed(Lexed *lexed) {
+    delete_ids(lexed->id_table);
+    delete_literals(lexed->literals);
+    delete_constants(lexed->constants);
+    delete_tokens(lexed->tokens);
+}
+
+// Spans of `a` and `b` with the same text
+int same_spans(const Vector *a, const Vector *b) {
+    if (a->length != b->length) {
+        return 0;
+    }
+    for (size_t i = 0; i < a->length; i++) {
+        Span *x = at_elem_vec((Vector *)a, i);
+        Span *y = at_elem_vec((Vector *)b, i);
+        if (x->len != y->len || memcmp(x->start, y->start, x->len)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// What differs between `got` and `expected`, 0 if nothing does
+const char *lexed_differ(const Lexed *got, const Lexed *expected) {
+    const Tokens *a = got->tokens, *b = expected->tokens;
+    if (a->length != b->length) {
+        return "token count";
+    }
+    for (size_t i = 0; i < a->length; i++) {
+        if (a->kind[i] != b->kind[i] || a->offset[i] != b->offset[i] ||
+            a->len[i] != b->len[i] || a->payload[i] != b->payload[i]) {
+            return "tokens";
+        }
+    }
+    if (!same_spans(got->id_table->spans, expected->id_table->spans)) {
+        return "ids";
+    } else if (!same_spans(got->literals->spans, expected->literals->spans)) {
+        return "literals";
+    }
+    const Vector *x = got->constants->bits, *y = expected->constants->bits;
+    if (x->length != y->length ||
+        memcmp(at_elem_vec((Vector *)x, 0), at_elem_vec((Vector *)y, 0),
+               x->length * sizeof(uint64_t))) {
+        return "constants";
+    }
+    return 0;
+}
+
+void lex_classes(char *buf, size_t len, ClassStats stats[Classes]) {
+    Stream stream = {.start = buf, .len = len, .base = 1};
+    Ids *id_table = create_ids(8);
+    Literals *literals = create_literals(8);
+    Constants *constants = create_constants(8);
+    for (;;) {
+        uint64_t start = now_cycles();
+        Lex lex = lex_next(&stream, id_table, literals, constants);
+        uint64_t cycles = now_cycles() - start;
+        if (lex.type == LEX_Eof) {
+            break;
+        }
+        ClassStats *class = &stats[token_class(lex.type)];
+        class->tokens += 1;
+        class->bytes += lex.span.len;
+        class->cycles += cycles;
+    }
+    delete_ids(id_table);
+    delete_literals(literals);
+    delete_constants(constants);
+}
+
+void report(const Bench *bench, const char *input, const char *mode,
+            size_t threads, const char *kind, size_t bytes, size_t tokens,
+            double time, uint64_t cycles) {
+    double mbs = time > 0 ? bytes / time / 1e6 : 0;
+    double rate = time > 0 ? tokens / time : 0;
+    double per_token = tokens ? (double)cycles / tokens : 0;
+    if (bench->csv) {
+        printf("\"%s\",%s,%zu,%s,%zu,%zu,%.6f,%.2f,%.0f,%.2f\n", input, mode,
+               threads, kind, bytes, tokens, time, mbs, rate, per_token);
+        return;
+    }
+
+    char name[64];
+    if (strcmp(kind, "all")) {
+        snprintf(name, sizeof(name), "  %s", kind);
+    } else {
+        snprintf(name, sizeof(name), threads ? "%s x%zu" : "%s", input,
+                 threads);
+    }
+    printf("%-24s %10zu bytes %9zu tokens %9.2f MB/s %12.0f tokens/s "
+           "%7.1f cycles/token\n",
+           name, bytes, tokens, mbs, rate, per_token);
+}
+
+void bench_source(Bench *bench, const char *input, Source *source) {
+    const char *mode = bench->threads ? "parallel"
+                       : bench->buffer ? "file"
+                                       : "next";
+    // Each thread count is also checked once against lex_file
+    Lexed expected = {0};
+    if (bench->threads) {
+        expected = lex_tables(source->start, source->len, 0);
+    }
+
+    // Without -j, a single run where threads is 0
+    for (size_t t = bench->threads ? 1 : 0; t <= bench->threads; t++) {
+        if (t) {
+            Lexed got = lex_tables(source->start, source->len, t);
+            const char *differ = lexed_differ(&got, &expected);
+            if (differ) {
+                fprintf(stderr, "%s x%zu: %s differ from lex_file\n", input,
+                        t, differ);
+                bench->mismatches += 1;
+            }
+            delete_lexed(&got);
+        }
+
+        size_t tokens = 0;
+        double start = now_sec();
+        uint64_t start_cycles = now_cycles();
+        for (size_t j = 0; j < bench->iters; j++) {
+            tokens = lex_all(source->start, source->len, bench->buffer, t);
+        }
+        uint64_t cycles = now_cycles() - start_cycles;
+        double time = now_sec() - start;
+
+        // Rows are for a single run, the totals for all of them
+        report(bench, input, mode, t, "all", source->len, tokens,
+               time / bench->iters, cycles / bench->iters);
+        bench->total_bytes += source->len * bench->iters;
+        bench->total_tokens += tokens * bench->iters;
+        bench->total_time += time;
+        bench->total_cycles += cycles;
+    }
+    if (bench->threads) {
+        delete_lexed(&expected);
+    }
+
+    if (bench->classes) {
+        ClassStats stats[Classes] = {0};
+        double start = now_sec();
+        uint64_t start_cycles = now_cycles();
+        lex_classes(source->start, source->len, stats);
+        uint64_t cycles = now_cycles() - start_cycles;
+        double time = now_sec() - start;
+
+        // Seconds of each kind in proportion to its cycles
+        double sec_per_cycle = cycles ? time / cycles : 0;
+        for (size_t i = 0; i < Classes; i++) {
+            if (stats[i].tokens) {
+                report(bench, input, "next", 0, class_names[i],
+                       stats[i].bytes, stats[i].tokens,
+                       stats[i].cycles * sec_per_cycle, stats[i].cycles);
+            }
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    Bench bench = {.iters = 20};
+    size_t synth_mb = 0;
+    int first = 1;
+    for (; first < argc; first++) {
+        if (!strcmp(argv[first], "-n") && first + 1 < argc) {
+            bench.iters = strtoull(argv[++first], 0, 10);
+            bench.iters = bench.iters ? bench.iters : 1;
+        } else if (!strcmp(argv[first], "-t")) {
+            bench.buffer = bench.buffer ? bench.buffer : create_tokens(1024);
+        } else if (!strcmp(argv[first], "-j") && first + 1 < argc) {
+            bench.threads = strtoull(argv[++first], 0, 10);
+            bench.buffer = bench.buffer ? bench.buffer : create_tokens(1024);
+        } else if (!strcmp(argv[first], "-k")) {
+            bench.classes = 1;
+        } else if (!strcmp(argv[first], "-c")) {
+            bench.csv = 1;
+        } else if (!strcmp(argv[first], "-g") && first + 1 < argc) {
+            synth_mb = strtoull(argv[++first], 0, 10);
+        } else if (!strcmp(argv[first], "-f") && first + 1 < argc) {
+            return check_floats(strtoull(argv[++first], 0, 10)) != 0;
+        } else {
+            break;
+        }
+    }
+    if (first >= argc && !synth_mb) {
+        puts("Usage: dfcc-bench [-n ITERS] [-t] [-j THREADS] [-k] [-c] "
+             "[-g MB] FILE...\n"
+             "       dfcc-bench -f COUNT");
+        return 1;
+    }
+
+    if (bench.csv) {
+        puts(CSV_HEADER);
+    }
+    for (int i = first; i < argc; i++) {
+        Source source;
+        if (open_source(argv[i], &source)) {
+            fprintf(stderr, "File \"%s\" could not be found\n", argv[i]);
+            continue;
+        }
+        Vector *splices;
+        if (splice_source(&source, &splices)) {
+            close_source(&source);
+            continue;
+        } else if (splices) {
+            delete_vec(splices);
+        }
+        bench_source(&bench, argv[i], &source);
+        close_source(&source);
+    }
+    for (size_t kind = 0; synth_mb && kind < SynthKinds; kind++) {
+        Source source;
+        if (synth_source(kind, synth_mb * 1000 * 1000, &source)) {
+            fprintf(stderr, "Could not generate %s\n", synth_names[kind]);
+            continue;
+        }
+        bench_source(&bench, synth_names[kind], &source);
+        close_source(&source);
+    }
+
+    report(&bench, "total", "all", 0, "all", bench.total_bytes,
+           bench.total_tokens, bench.total_time, bench.total_cycles);
+    if (bench.buffer) {
+        delete_tokens(bench.buffer);
+    }
+    return bench.mismatches != 0;
+}
@@ -0,0 +1,167 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "synth.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char *const synth_names[SynthKinds] = {
+    [SynthLongIds] = "long-ids",
+    [SynthComments] = "comments",
+    [SynthNumbers] = "numbers",
+    [SynthManyIds] = "many-ids",
+};
+
+// Room for the longest line a generator writes at once
+#define SYNTH_SLACK (20 * 1024)
+
+typedef struct Synth {
+    char *start;
+    size_t len;
+    uint64_t state;
+    uint64_t count;
+} Synth;
+
+// xorshift64, enough to vary the inputs
+uint64_t synth_random(Synth *synth) {
+    uint64_t x = synth->state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    synth->state = x;
+    return x;
+}
+
+size_t synth_range(Synth *synth, size_t low, size_t high) {
+    return low + synth_random(synth) % (high - low + 1);
+}
+
+void synth_put(Synth *synth, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    synth->len +=
+        vsnprintf(synth->start + synth->len, SYNTH_SLACK, format, args);
+    va_end(args);
+}
+
+void synth_id(Synth *synth, size_t len) {
+    static const char chars[] = "abcdefghijklmnopqrstuvwxyz"
+                                "ABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789";
+    // Not starting with a digit
+    for (size_t i = 0; i < len; i++) {
+        synth->start[synth->len++] =
+            chars[synth_random(synth) % (i ? sizeof(chars) - 1 : 53)];
+    }
+}
+
+void synth_long_ids(Synth *synth) {
+    synth_id(synth, synth_range(synth, 64, 255));
+    synth_put(synth, " = ");
+    synth_id(synth, synth_range(synth, 64, 255));
+    synth_put(synth, " + ");
+    synth_id(synth, synth_range(synth, 64, 255));
+    synth_put(synth, ";\n");
+}
+
+void synth_comments(Synth *synth) {
+    static const char *const words[] = {
+        "the", "lexer", "skips", "this", "text", "*", "/", "a*b", "x/y",
+        "//",  "\"",    "'",     "#if", "\t",   "**", "int", "0x1f",
+    };
+    size_t count = sizeof(words) / sizeof(words[0]);
+
+    synth_put(synth, "/*");
+    size_t end = synth->len + synth_range(synth, 2048, 16384);
+    while (synth->len < end) {
+        synth_put(synth, synth_range(synth, 0, 11) ? " %s" : "\n * %s",
+                  words[synth_random(synth) % count]);
+    }
+    synth_put(synth, " */\n");
+
+    for (size_t lines = synth_range(synth, 1, 8); lines; lines--) {
+        synth_put(synth, "//");
+        end = synth->len + synth_range(synth, 40, 120);
+        while (synth->len < end) {
+            synth_put(synth, " %s", words[synth_random(synth) % count]);
+        }
+        synth_put(synth, "\n");
+    }
+    synth_put(synth, "int x%zu = 0;\n", synth_range(synth, 0, 999));
+}
+
+void synth_numbers(Synth *synth) {
+    static const char *const int_suffixes[] = {"", "u", "l", "ul", "ll",
+                                               "ULL", "wb"};
+    static const char *const float_suffixes[] = {"", "f", "L"};
+    static const char *const chars[] = {"'a'", "'\\n'", "'\\177'", "'\\0'",
+                                        "L'z'", "u'\\''"};
+
+    synth_put(synth, "static const long double t%zu[] = {\n",
+              synth_range(synth, 0, 999));
+    for (size_t row = 0; row < 32; row++) {
+        synth_put(synth, "   ");
+        for (size_t col = 0; col < 8; col++) {
+            uint64_t value = synth_random(synth) >> synth_range(synth, 0, 60);
+            switch (synth_range(synth, 0, 6)) {
+            case 0:
+            case 1:
+                synth_put(synth, " %llu%s", (unsigned long long)value,
+                          int_suffixes[synth_random(synth) % 7]);
+                break;
+            case 2:
+                synth_put(synth, " 0x%llX%s", (unsigned long long)value,
+                          int_suffixes[synth_random(synth) % 7]);
+                break;
+            case 3:
+                synth_put(synth, " 0%llo", (unsigned long long)value);
+                break;
+            case 4:
+                synth_put(synth, " %.*g%s", (int)synth_range(synth, 1, 17),
+                          (double)value / (synth_random(synth) | 1),
+                          float_suffixes[synth_random(synth) % 3]);
+                break;
+            case 5:
+                synth_put(synth, " %a", (double)value * 1e-3);
+                break;
+            default:
+                synth_put(synth, " %s", chars[synth_random(synth) % 6]);
+            }
+            synth_put(synth, ",");
+        }
+        synth_put(synth, "\n");
+    }
+    synth_put(synth, "};\n");
+}
+
+void synth_many_ids(Synth *synth) {
+    // The count keeps them distinct, the rest varies their length and hash
+    synth_put(synth, "int v%llx_", (unsigned long long)synth->count++);
+    synth_id(synth, synth_range(synth, 1, 12));
+    synth_put(synth, " = w%llx_", (unsigned long long)synth->count++);
+    synth_id(synth, synth_range(synth, 1, 12));
+    synth_put(synth, ";\n");
+}
+
+int synth_source(enum synth_kind kind, size_t size, Source *source) {
+    static void (*const generators[SynthKinds])(Synth *) = {
+        [SynthLongIds] = synth_long_ids,
+        [SynthComments] = synth_comments,
+        [SynthNumbers] = synth_numbers,
+        [SynthManyIds] = synth_many_ids,
+    };
+
+    Synth synth = {malloc(size + SYNTH_SLACK + 1 + SOURCE_PADDING), 0,
+                   0x9E3779B97F4A7C15ull + kind, 0};
+    if (!synth.start) {
+        return 1;
+    }
+    while (synth.len < size) {
+        generators[kind](&synth);
+    }
+    synth.start[synth.len] = '\n';
+    memset(synth.start + synth.len + 1, 0, SOURCE_PADDING);
+    *source = (Source){synth.start, synth.len, 0};
+    return 0;
+}
@@ -0,0 +1,26 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef SYNTH_H_
+#define SYNTH_H_
+
+#include "lib/source.h"
+
+// Generated inputs that stress one part of the lexer each.
+// They are made from a fixed seed, so every run lexes the same bytes.
+
+enum synth_kind {
+    SynthLongIds = 0, // Identifiers of 64 to 255 characters
+    SynthComments,    // Large block and line comments around a little code
+    SynthNumbers,     // Tables of integer, floating and char constants
+    SynthManyIds,     // Mostly distinct identifiers, to grow the id table
+    SynthKinds,
+};
+
+extern const char *const synth_names[SynthKinds];
+
+// A source of about `size` bytes, padded like open_source does.
+// Returns 1 if it could not be allocated.
+int synth_source(enum synth_kind kind, size_t size, Source *source);
+
+#endif // SYNTH_H_
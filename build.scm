@@ -13,11 +13,35 @@
                              (command-line))))
 (define install? (memq #t (map (lambda (x) (equal? "install" x))
                                (command-line))))
+(define bench? (memq #t (map (lambda (x) (equal? "bench" x))
+                             (command-line))))
+(define stats? (memq #t (map (lambda (x) (equal? "stats" x))
+                             (command-line))))
 (define compile? (not clean?))
 
+;; Benchmarks in bench/ link against an optimized static libdfcc
+(when (or bench? clean?)
+  (let ((lib-config (configure #:lib-src-dir "src/lib" #:lib-name "libdfcc" #:lib-type 'static
+                               #:optimization "-O2"
+                               #:link '("m" "pthread")
+                               #:derive '(DYNAMIC_TABLE)))
+        (bench-config (configure #:exe-name "dfcc-bench" #:src-dir "bench"
+                                 #:optimization "-O2"
+                                 #:include '("src")
+                                 #:link '("dfcc" "m" "pthread")
+                                 #:link-path '("build")
+                                 #:derive '(DYNAMIC_TABLE))))
+    (compile-c lib-config bench?)
+    (compile-c bench-config bench?)
+    (clean bench-config clean?)
+    (clean lib-config clean?)))
+
+;; With "stats", dfcc counts its hot paths for --stats, see src/lib/stats.h
 (let ((config (configure #:exe-name "dfcc" ;;#:lib-source-dir "src/lib" #:lib-name "libdfcc" #:lib-type 'both)
-                         #:link '("m")
-                         #:derive '(DYNAMIC_TABLE))))
+                         #:link '("m" "pthread")
+                         #:derive (if stats?
+                                      '(DYNAMIC_TABLE DFCC_STATS)
+                                      '(DYNAMIC_TABLE)))))
   (compile-c config compile?)
   (install config install?)
   (clean config clean?))
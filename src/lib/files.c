@@ -0,0 +1,251 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "files.h"
+#include "lexer.h"
+#include "stats.h"
+#include <linux/limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// Key of `Files.names`, a name in a directory
+typedef struct NameKey {
+    uint64_t hash;
+    size_t dir;
+    const char *name;
+    size_t len;
+} NameKey;
+
+int name_key_eq(const void *key, const void *elem_key) {
+    const NameKey *a = key;
+    const NameKey *b = elem_key;
+    return a->hash == b->hash && a->dir == b->dir && a->len == b->len &&
+           !memcmp(a->name, b->name, a->len);
+}
+
+Files *create_files(size_t capacity) {
+    Files *files = malloc(sizeof(*files));
+    files->files = create_vec(capacity, sizeof(File));
+    files->spellings = create_vec(capacity, sizeof(String *));
+    files->paths = create_dht(capacity, sizeof(IdKey), sizeof(size_t));
+    files->ids = create_dht(capacity, sizeof(FileId), sizeof(size_t));
+    files->dirs = create_vec(capacity, sizeof(String *));
+    files->dir_index = create_dht(capacity, sizeof(IdKey), sizeof(size_t));
+    files->names = create_dht(capacity, sizeof(NameKey), sizeof(size_t));
+    files->search = create_vec(capacity, sizeof(size_t));
+    memset(files->ends, 0, sizeof(files->ends));
+    return files;
+}
+
+void delete_files(Files *files) {
+    for (size_t i = 0; i < files->files->length; i++) {
+        File *file = at_elem_vec(files->files, i);
+        delete_str(file->path);
+        close_source(&file->source);
+    }
+    for (size_t i = 0; i < files->spellings->length; i++) {
+        delete_str(*(String **)at_elem_vec(files->spellings, i));
+    }
+    for (size_t i = 0; i < files->dirs->length; i++) {
+        delete_str(*(String **)at_elem_vec(files->dirs, i));
+    }
+    delete_vec(files->files);
+    delete_vec(files->spellings);
+    delete_dht(files->paths);
+    delete_dht(files->ids);
+    delete_vec(files->dirs);
+    delete_dht(files->dir_index);
+    delete_dht(files->names);
+    delete_vec(files->search);
+    free(files);
+}
+
+File *get_file(Files *files, size_t idx) {
+    return at_elem_vec(files->files, idx);
+}
+
+// Idx in `dirs` of `len` bytes at `path`, ending in '/'
+size_t add_dir(Files *files, const char *path, size_t len) {
+    IdKey key = {word_hash((const uint8_t *)path, len), (char *)path, len};
+    size_t *found = get_hashed_elem_dht(files->dir_index, &key, id_key_eq);
+    if (found) {
+        return *found;
+    }
+    String *dir = create_str(len + 1);
+    push_slice_str(&dir, (char *)path, len);
+    size_t idx = files->dirs->length;
+    push_elem_vec(&files->dirs, &dir);
+    key.start = dir->s;
+    put_hashed_elem_dht(&files->dir_index, &key, &idx, id_key_eq);
+    return idx;
+}
+
+// Its directory with symlinks resolved, as includes are relative to that.
+// Without a real path, like for standard input, it is the one spelled.
+size_t file_dir(Files *files, const char *path, size_t len) {
+    char real[PATH_MAX];
+    const char *dir = path;
+    if (realpath(path, real)) {
+        dir = real;
+        len = strlen(real);
+    }
+    while (len && dir[len - 1] != '/') {
+        len -= 1;
+    }
+    return add_dir(files, dir, len);
+}
+
+// Read `path` and add it as a new file, known by `id`.
+// `path` is the file's after this, unless it could not be read.
+enum source_error open_file(Files *files, String *path, FileId id,
+                            Locations *locations, size_t *idx) {
+    Source source;
+    enum source_error error = open_source(path->s, &source);
+    if (error) {
+        return error;
+    }
+
+    Vector *splices;
+    if (splice_source(&source, &splices)) {
+        close_source(&source);
+        return SourceUnreadable;
+    }
+
+    if (!source.len || source.start[source.len - 1] == '\\') {
+        if (source.len) {
+            puts("Last character cannot be '\\'");
+        }
+        if (splices) {
+            delete_vec(splices);
+        }
+        close_source(&source);
+        return SourceUnreadable;
+    }
+
+    STAT_ADD(include_opens, 1);
+    *idx = files->files->length;
+    push_elem_vec(&files->files,
+                  &(File){
+                      .path = path,
+                      .dir = file_dir(files, path->s, path->length - 1),
+                      .source = source,
+                      .base = add_source_file(locations, source.start,
+                                              source.len, splices),
+                      .guard = NO_GUARD,
+                      .once = 0,
+                      .resc = SIZE_MAX,
+                  });
+    put_elem_dht(&files->ids, &id, idx);
+    return SourceOk;
+}
+
+enum source_error find_file(Files *files, const char *path, size_t len,
+                            Locations *locations, size_t *idx) {
+    IdKey key = {word_hash((const uint8_t *)path, len), (char *)path, len};
+    size_t *found = get_hashed_elem_dht(files->paths, &key, id_key_eq);
+    if (found) {
+        *idx = *found;
+        return SourceOk;
+    }
+
+    // Another spelling of a file already read is only kept as one
+    String *spelling = create_str(len + 1);
+    push_slice_str(&spelling, (char *)path, len);
+    push_elem_str(&spelling, '\0');
+    FileId id;
+    STAT_ADD(include_stats, 1);
+    enum source_error error = file_id(spelling->s, &id);
+    if (error) {
+        delete_str(spelling);
+        return error;
+    }
+    found = get_elem_dht(files->ids, &id);
+    if (found) {
+        *idx = *found;
+        push_elem_vec(&files->spellings, &spelling);
+    } else if ((error = open_file(files, spelling, id, locations, idx))) {
+        delete_str(spelling);
+        return error;
+    }
+    key.start = spelling->s;
+    put_hashed_elem_dht(&files->paths, &key, idx, id_key_eq);
+    return SourceOk;
+}
+
+int add_search_dir(Files *files, const char *path, enum search_kind kind) {
+    char real[PATH_MAX];
+    struct stat st_buf;
+    if (!realpath(path, real) || stat(real, &st_buf) ||
+        !S_ISDIR(st_buf.st_mode)) {
+        return 1;
+    }
+    size_t len = strlen(real);
+    if (real[len - 1] != '/') {
+        real[len++] = '/';
+    }
+
+    size_t dir = add_dir(files, real, len);
+    for (size_t i = 0; i < files->search->length; i++) {
+        if (*(size_t *)at_elem_vec(files->search, i) == dir) {
+            return 1;
+        }
+    }
+
+    // Moved up past the later kinds
+    size_t at = files->ends[kind];
+    push_elem_vec(&files->search, &dir);
+    size_t *search = at_elem_vec(files->search, 0);
+    memmove(search + at + 1, search + at,
+            (files->search->length - 1 - at) * sizeof(size_t));
+    search[at] = dir;
+    for (size_t i = kind; i < SearchKinds; i++) {
+        files->ends[i] += 1;
+    }
+    return 0;
+}
+
+enum source_error find_in_dir(Files *files, size_t dir, const char *name,
+                              size_t len, Locations *locations, size_t *idx) {
+    NameKey key = {word_hash((const uint8_t *)name, len) ^
+                       (dir * 0x9E3779B97F4A7C15ull),
+                   dir, name, len};
+    size_t *found = get_hashed_elem_dht(files->names, &key, name_key_eq);
+    if (found) {
+        *idx = *found;
+        return *found == SIZE_MAX ? SourceNotFound : SourceOk;
+    }
+
+    String *dir_path = *(String **)at_elem_vec(files->dirs, dir);
+    String *path = create_str(dir_path->length + len + 1);
+    push_slice_str(&path, dir_path->s, dir_path->length);
+    push_slice_str(&path, (char *)name, len);
+    push_elem_str(&path, '\0');
+    enum source_error error =
+        find_file(files, path->s, path->length - 1, locations, idx);
+    if (error && error != SourceNotFound) {
+        delete_str(path);
+        return error;
+    }
+
+    // Found or not, it is not asked again
+    push_elem_vec(&files->spellings, &path);
+    key.name = path->s + dir_path->length;
+    put_hashed_elem_dht(&files->names, &key, error ? &(size_t){SIZE_MAX} : idx,
+                        name_key_eq);
+    return error;
+}
+
+enum source_error search_file(Files *files, const char *name, size_t len,
+                              size_t *at, Locations *locations, size_t *idx) {
+    for (; *at < files->search->length; *at += 1) {
+        size_t dir = *(size_t *)at_elem_vec(files->search, *at);
+        enum source_error error =
+            find_in_dir(files, dir, name, len, locations, idx);
+        if (error != SourceNotFound) {
+            return error;
+        }
+    }
+    return SourceNotFound;
+}
@@ -0,0 +1,84 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef FILES_H_
+#define FILES_H_
+
+#include "got.h"
+#include "loc.h"
+#include "source.h"
+#include "vec.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Files of a translation unit, each read once however often it is included.
+// A file is known by its FileId, so symlinks and other spellings of its path
+// share it, and each spelling seen is kept to find it again without asking
+// the file system. Buffers are read only and live until delete_files.
+//
+// Included names are looked up in directories, where each name is asked of
+// the file system once per directory, whether it was there or not. So a long
+// search path costs a stat per directory only the first time a header is
+// included, after that a hash lookup per directory.
+
+#define NO_GUARD SIZE_MAX
+#define NO_SEARCH SIZE_MAX
+
+// Kinds of directories in the search path, searched in this order
+enum search_kind {
+    SearchQuote = 0, // -iquote, only for #include "..."
+    SearchAngled,    // -I
+    SearchSystem,    // -isystem
+    SearchDefault,   // Built in, left out with -nostdinc
+    SearchKinds,
+};
+
+typedef struct File {
+    String *path; // As first spelled
+    size_t dir;   // Idx in `Files.dirs` of its directory, symlinks resolved
+    Source source;
+    Loc base;     // Of its text in Locations
+    size_t guard; // mid of the macro of its include guard, or NO_GUARD
+    int once;     // Had #pragma once
+    size_t resc;  // Idx of the last include resource over it, or SIZE_MAX
+} File;
+
+typedef struct Files {
+    Vector *files;     // File
+    Vector *spellings; // String *, keys of `paths` and `names` kept alive
+    HashTable *paths;  // IdKey of a path as spelled -> idx in `files`
+    HashTable *ids;    // FileId -> idx in `files`
+    Vector *dirs;      // String *, real path ending in '/', without a null
+    HashTable *dir_index; // IdKey of a real path -> idx in `dirs`
+    HashTable *names;  // NameKey -> idx in `files`, or SIZE_MAX if not there
+    Vector *search;    // Idxs in `dirs`, in the order they are searched
+    size_t ends[SearchKinds]; // End in `search` of each kind
+} Files;
+
+Files *create_files(size_t capacity);
+
+// Closes every file and frees every path
+void delete_files(Files *files);
+
+// Idx of the file at `path` of `len` bytes in `idx`.
+// It is read and added to `locations` only if no spelling of it was seen.
+enum source_error find_file(Files *files, const char *path, size_t len,
+                            Locations *locations, size_t *idx);
+
+File *get_file(Files *files, size_t idx);
+
+// Search `path` for includes as well, after the others of its kind.
+// A directory that does not exist or is searched already is left out,
+// which returns 1.
+int add_search_dir(Files *files, const char *path, enum search_kind kind);
+
+// find_file for `name` of `len` bytes in directory `dir`
+enum source_error find_in_dir(Files *files, size_t dir, const char *name,
+                              size_t len, Locations *locations, size_t *idx);
+
+// find_in_dir in each directory of the search path from `*at` on, which is
+// left at the one it was found in
+enum source_error search_file(Files *files, const char *name, size_t len,
+                              size_t *at, Locations *locations, size_t *idx);
+
+#endif // FILES_H_
@@ -0,0 +1,28 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef FPCONV_H_
+#define FPCONV_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Correctly rounded conversion of floating constants to binary64.
+// Nothing here allocates.
+
+// `mantissa` * 10^`exp10`, where `mantissa` holds the first 19 significant
+// digits of the constant. If `truncated`, nonzero digits were dropped after
+// them, and the rounding might be decided by reading the whole constant
+// again from `digits`, its `len` bytes of digits, '.' and ' separators,
+// scaled by 10^`exp`.
+double decimal_to_double(uint64_t mantissa, int64_t exp10, int truncated,
+                         const char *digits, size_t len, int64_t exp);
+
+// `mantissa` * 2^`exp2`, where `truncated` means nonzero bits were dropped
+// below `mantissa`.
+double binary_to_double(uint64_t mantissa, int64_t exp2, int truncated);
+
+// Bits of `value`, as floating constants are stored
+uint64_t to_bits(double value);
+
+#endif // FPCONV_H_
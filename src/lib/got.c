@@ -2,6 +2,7 @@
    License, v. 2.0. If a copy of the MPL was not distributed with this
    file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include "got.h"
+#include "stats.h"
 
 #if !(defined(memcpy) && defined(memcmp))
 #include <string.h>
@@ -27,6 +28,16 @@ uint64_t power_of_two(uint64_t x) {
 
 #define calc_control_size(len) (len + (len % GROUP_SIZE))
 
+// Mask of the group slots that are inside the table.
+// The last group may overhang into the elements, which must not be probed.
+#ifdef __SSE2__
+#define calc_group_bound(cap, i)                                               \
+    (((cap) - (i) < GROUP_SIZE) ? (1 << ((cap) - (i))) - 1 : 0xFFFF)
+#else
+#define calc_group_bound(cap, i)                                               \
+    (((cap) - (i) < GROUP_SIZE) ? (1ull << (((cap) - (i)) * 8)) - 1 : ~0ull)
+#endif
+
 #define calc_elems_size(len, key_size, val_size)                               \
     ((len + (len % GROUP_SIZE)) * (key_size + 1) +                             \
      (len + (len % GROUP_SIZE)) * val_size)
@@ -40,6 +51,22 @@ uint64_t fnv1a_hash(const uint8_t *input, const size_t length) {
     return init;
 }
 
+uint64_t word_hash(const uint8_t *input, const size_t length) {
+    uint64_t init = 12698850840868882907ull ^ length;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, input + i, 8);
+        init = (init ^ word) * 1111111111111111111;
+        init ^= init >> 29;
+    }
+    for (; i < length; i++) {
+        init ^= input[i];
+        init *= 1111111111111111111;
+    }
+    return init ^ (init >> 32);
+}
+
 HashTable *create_ht(void *memory, const size_t len, const size_t key_size,
                      const size_t val_size) {
     HashTable *ht = memory;
@@ -95,7 +122,8 @@ uint32_t put_elem_ht(HashTable *ht, const void *key, const void *value) {
     for (size_t i = lo & (ht->capacity - 1); i < ht->capacity;
          i += GROUP_SIZE) {
         __m128i controlv = _mm_loadu_si128((__m128i *)(control + i));
-        int res = _mm_movemask_epi8(_mm_cmpeq_epi8(hiv, controlv));
+        int bound = calc_group_bound(ht->capacity, i);
+        int res = _mm_movemask_epi8(_mm_cmpeq_epi8(hiv, controlv)) & bound;
         while (res) {
             size_t j = i + __builtin_ctz(res);
             if (!memcmp(key, elem + j * elem_size(ht), ht->key_size)) {
@@ -106,7 +134,7 @@ uint32_t put_elem_ht(HashTable *ht, const void *key, const void *value) {
             res &= res - 1;
         }
 
-        res = _mm_movemask_epi8(_mm_and_si128(controlv, emptyv));
+        res = _mm_movemask_epi8(_mm_and_si128(controlv, emptyv)) & bound;
         if (res) {
             size_t j = i + __builtin_ctz(res);
             control[j] = hi;
@@ -123,8 +151,9 @@ uint32_t put_elem_ht(HashTable *ht, const void *key, const void *value) {
     for (size_t i = lo & (ht->capacity - 1); i < ht->capacity;
          i += GROUP_SIZE) {
         uint64_t controlv = *(uint64_t *)(control + i);
+        uint64_t bound = calc_group_bound(ht->capacity, i);
         uint64_t res = (((hiv ^ controlv) - onev) & ~(hiv ^ controlv)) &
-                       0x8080808080808080ull;
+                       0x8080808080808080ull & bound;
         while (res) {
             size_t j = i + (__builtin_ctzll(res) >> 3);
             if (!memcmp(key, elem + j * elem_size(ht), ht->key_size)) {
@@ -135,9 +164,9 @@ uint32_t put_elem_ht(HashTable *ht, const void *key, const void *value) {
             res &= res - 1;
         }
 
-        res = controlv & emptyv;
+        res = controlv & emptyv & bound;
         if (res) {
-            size_t j = i + __builtin_ctzll(res) >> 3;
+            size_t j = i + (__builtin_ctzll(res) >> 3);
             control[j] = hi;
             copy_elem(ht, j, key, value);
             ht->length += 1;
@@ -158,15 +187,19 @@ void *get_elem_ht(HashTable *ht, const void *key) {
     uint64_t hi = keyhash & 0xFE00000000000000ull;
     uint64_t lo = keyhash ^ hi;
     hi >>= 57;
+    STAT_ADD(table_lookups, 1);
 
 #ifdef __SSE2__
     const __m128i emptyv = _mm_set1_epi8(0x80);
     __m128i hiv = _mm_set1_epi8(hi);
     for (size_t i = lo & (ht->capacity - 1); i < ht->capacity;
          i += GROUP_SIZE) {
+        STAT_ADD(table_groups, 1);
         __m128i controlv = _mm_loadu_si128((__m128i *)(control + i));
-        int res = _mm_movemask_epi8(_mm_cmpeq_epi8(hiv, controlv));
+        int bound = calc_group_bound(ht->capacity, i);
+        int res = _mm_movemask_epi8(_mm_cmpeq_epi8(hiv, controlv)) & bound;
         while (res) {
+            STAT_ADD(table_compares, 1);
             size_t j = i + __builtin_ctz(res);
             if (!memcmp(key, elem + j * elem_size(ht), ht->key_size)) {
                 return elem + j * elem_size(ht) + ht->key_size;
@@ -174,7 +207,7 @@ void *get_elem_ht(HashTable *ht, const void *key) {
             res &= res - 1;
         }
 
-        if (_mm_movemask_epi8(_mm_cmpeq_epi8(controlv, emptyv))) {
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(controlv, emptyv)) & bound) {
             return 0;
         }
     }
@@ -185,10 +218,13 @@ void *get_elem_ht(HashTable *ht, const void *key) {
     uint64_t hiv = onev * hi;
     for (size_t i = lo & (ht->capacity - 1); i < ht->capacity;
          i += GROUP_SIZE) {
+        STAT_ADD(table_groups, 1);
         uint64_t controlv = *(uint64_t *)(control + i);
+        uint64_t bound = calc_group_bound(ht->capacity, i);
         uint64_t res = (((hiv ^ controlv) - onev) & ~(hiv ^ controlv)) &
-                       0x8080808080808080ull;
+                       0x8080808080808080ull & bound;
         while (res) {
+            STAT_ADD(table_compares, 1);
             size_t j = i + (__builtin_ctzll(res) >> 3);
             if (!memcmp(key, elem + j * elem_size(ht), ht->key_size)) {
                 return elem + j * elem_size(ht) + ht->key_size;
@@ -196,7 +232,7 @@ void *get_elem_ht(HashTable *ht, const void *key) {
             res &= res - 1;
         }
 
-        if ((((controlv ^ emptyv) - onev) & ~(controlv ^ emptyv))) {
+        if ((((controlv ^ emptyv) - onev) & ~(controlv ^ emptyv)) & bound) {
             return 0;
         }
     }
@@ -221,7 +257,8 @@ uint32_t delete_elem_ht(HashTable *ht, const void *key) {
     for (size_t i = lo & (ht->capacity - 1); i < ht->capacity;
          i += GROUP_SIZE) {
         __m128i controlv = _mm_loadu_si128((__m128i *)(control + i));
-        int res = _mm_movemask_epi8(_mm_cmpeq_epi8(hiv, controlv));
+        int bound = calc_group_bound(ht->capacity, i);
+        int res = _mm_movemask_epi8(_mm_cmpeq_epi8(hiv, controlv)) & bound;
         while (res) {
             size_t j = i + __builtin_ctz(res);
             if (!memcmp(key, elem + j * elem_size(ht), ht->key_size)) {
@@ -232,7 +269,7 @@ uint32_t delete_elem_ht(HashTable *ht, const void *key) {
             res &= res - 1;
         }
 
-        if (_mm_movemask_epi8(_mm_cmpeq_epi8(controlv, emptyv))) {
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(controlv, emptyv)) & bound) {
             return 0;
         }
     }
@@ -244,8 +281,9 @@ uint32_t delete_elem_ht(HashTable *ht, const void *key) {
     for (size_t i = lo & (ht->capacity - 1); i < ht->capacity;
          i += GROUP_SIZE) {
         uint64_t controlv = *(uint64_t *)(control + i);
+        uint64_t bound = calc_group_bound(ht->capacity, i);
         uint64_t res = (((hiv ^ controlv) - onev) & ~(hiv ^ controlv)) &
-                       0x8080808080808080ull;
+                       0x8080808080808080ull & bound;
         while (res) {
             size_t j = i + (__builtin_ctzll(res) >> 3);
             if (!memcmp(key, elem + j * elem_size(ht), ht->key_size)) {
@@ -256,7 +294,7 @@ uint32_t delete_elem_ht(HashTable *ht, const void *key) {
             res &= res - 1;
         }
 
-        if ((((controlv ^ emptyv) - onev) & ~(controlv ^ emptyv))) {
+        if ((((controlv ^ emptyv) - onev) & ~(controlv ^ emptyv)) & bound) {
             return 0;
         }
     }
@@ -282,7 +320,8 @@ uint32_t deletecb_elem_ht(HashTable *ht, const void *key,
     for (size_t i = lo & (ht->capacity - 1); i < ht->capacity;
          i += GROUP_SIZE) {
         __m128i controlv = _mm_loadu_si128((__m128i *)(control + i));
-        int res = _mm_movemask_epi8(_mm_cmpeq_epi8(hiv, controlv));
+        int bound = calc_group_bound(ht->capacity, i);
+        int res = _mm_movemask_epi8(_mm_cmpeq_epi8(hiv, controlv)) & bound;
         while (res) {
             size_t j = i + __builtin_ctz(res);
             if (!memcmp(key, elem + j * elem_size(ht), ht->key_size)) {
@@ -294,7 +333,7 @@ uint32_t deletecb_elem_ht(HashTable *ht, const void *key,
             res &= res - 1;
         }
 
-        if (_mm_movemask_epi8(_mm_cmpeq_epi8(controlv, emptyv))) {
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(controlv, emptyv)) & bound) {
             return 0;
         }
     }
@@ -306,8 +345,9 @@ uint32_t deletecb_elem_ht(HashTable *ht, const void *key,
     for (size_t i = lo & (ht->capacity - 1); i < ht->capacity;
          i += GROUP_SIZE) {
         uint64_t controlv = *(uint64_t *)(control + i);
+        uint64_t bound = calc_group_bound(ht->capacity, i);
         uint64_t res = (((hiv ^ controlv) - onev) & ~(hiv ^ controlv)) &
-                       0x8080808080808080ull;
+                       0x8080808080808080ull & bound;
         while (res) {
             size_t j = i + (__builtin_ctzll(res) >> 3);
             if (!memcmp(key, elem + j * elem_size(ht), ht->key_size)) {
@@ -319,7 +359,213 @@ uint32_t deletecb_elem_ht(HashTable *ht, const void *key,
             res &= res - 1;
         }
 
-        if ((((controlv ^ emptyv) - onev) & ~(controlv ^ emptyv))) {
+        if ((((controlv ^ emptyv) - onev) & ~(controlv ^ emptyv)) & bound) {
+            return 0;
+        }
+    }
+
+#endif
+
+    return 0;
+}
+
+uint32_t put_hashed_elem_ht(HashTable *ht, const void *key, const void *value,
+                            int eq(const void *key, const void *elem_key)) {
+    if (ht->length >= ((ht->capacity * 4) / 5))
+        return 0;
+
+    uint8_t *control = ht->elems;
+    uint8_t *elem = ht->elems + calc_control_size(ht->capacity);
+
+    uint64_t keyhash = *(uint64_t *)key;
+    uint64_t hi = keyhash & 0xFE00000000000000ull;
+    uint64_t lo = keyhash ^ hi;
+    hi >>= 57;
+
+#ifdef __SSE2__
+    const __m128i emptyv = _mm_set1_epi8(0x80);
+    __m128i hiv = _mm_set1_epi8(hi);
+    for (size_t i = lo & (ht->capacity - 1); i < ht->capacity;
+         i += GROUP_SIZE) {
+        __m128i controlv = _mm_loadu_si128((__m128i *)(control + i));
+        int bound = calc_group_bound(ht->capacity, i);
+        int res = _mm_movemask_epi8(_mm_cmpeq_epi8(hiv, controlv)) & bound;
+        while (res) {
+            size_t j = i + __builtin_ctz(res);
+            if (eq(key, elem + j * elem_size(ht))) {
+                memcpy(elem + j * elem_size(ht) + ht->key_size, value,
+                       ht->val_size);
+                return 2;
+            }
+            res &= res - 1;
+        }
+
+        res = _mm_movemask_epi8(_mm_and_si128(controlv, emptyv)) & bound;
+        if (res) {
+            size_t j = i + __builtin_ctz(res);
+            control[j] = hi;
+            copy_elem(ht, j, key, value);
+            ht->length += 1;
+            return 1;
+        }
+    }
+
+#else // SWAR
+    const uint64_t emptyv = 0x8080808080808080ull;
+    const uint64_t onev = 0x0101010101010101ull;
+    uint64_t hiv = onev * hi;
+    for (size_t i = lo & (ht->capacity - 1); i < ht->capacity;
+         i += GROUP_SIZE) {
+        uint64_t controlv = *(uint64_t *)(control + i);
+        uint64_t bound = calc_group_bound(ht->capacity, i);
+        uint64_t res = (((hiv ^ controlv) - onev) & ~(hiv ^ controlv)) &
+                       0x8080808080808080ull & bound;
+        while (res) {
+            size_t j = i + (__builtin_ctzll(res) >> 3);
+            if (eq(key, elem + j * elem_size(ht))) {
+                memcpy(elem + j * elem_size(ht) + ht->key_size, value,
+                       ht->val_size);
+                return 2;
+            }
+            res &= res - 1;
+        }
+
+        res = controlv & emptyv & bound;
+        if (res) {
+            size_t j = i + (__builtin_ctzll(res) >> 3);
+            control[j] = hi;
+            copy_elem(ht, j, key, value);
+            ht->length += 1;
+            return 1;
+        }
+    }
+
+#endif
+
+    return 0;
+}
+
+void *get_hashed_elem_ht(HashTable *ht, const void *key,
+                         int eq(const void *key, const void *elem_key)) {
+    uint8_t *control = ht->elems;
+    uint8_t *elem = ht->elems + calc_control_size(ht->capacity);
+
+    uint64_t keyhash = *(uint64_t *)key;
+    uint64_t hi = keyhash & 0xFE00000000000000ull;
+    uint64_t lo = keyhash ^ hi;
+    hi >>= 57;
+    STAT_ADD(table_lookups, 1);
+
+#ifdef __SSE2__
+    const __m128i emptyv = _mm_set1_epi8(0x80);
+    __m128i hiv = _mm_set1_epi8(hi);
+    for (size_t i = lo & (ht->capacity - 1); i < ht->capacity;
+         i += GROUP_SIZE) {
+        STAT_ADD(table_groups, 1);
+        __m128i controlv = _mm_loadu_si128((__m128i *)(control + i));
+        int bound = calc_group_bound(ht->capacity, i);
+        int res = _mm_movemask_epi8(_mm_cmpeq_epi8(hiv, controlv)) & bound;
+        while (res) {
+            STAT_ADD(table_compares, 1);
+            size_t j = i + __builtin_ctz(res);
+            if (eq(key, elem + j * elem_size(ht))) {
+                return elem + j * elem_size(ht) + ht->key_size;
+            }
+            res &= res - 1;
+        }
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(controlv, emptyv)) & bound) {
+            return 0;
+        }
+    }
+
+#else // SWAR
+    const uint64_t emptyv = 0x8080808080808080ull;
+    const uint64_t onev = 0x0101010101010101ull;
+    uint64_t hiv = onev * hi;
+    for (size_t i = lo & (ht->capacity - 1); i < ht->capacity;
+         i += GROUP_SIZE) {
+        STAT_ADD(table_groups, 1);
+        uint64_t controlv = *(uint64_t *)(control + i);
+        uint64_t bound = calc_group_bound(ht->capacity, i);
+        uint64_t res = (((hiv ^ controlv) - onev) & ~(hiv ^ controlv)) &
+                       0x8080808080808080ull & bound;
+        while (res) {
+            STAT_ADD(table_compares, 1);
+            size_t j = i + (__builtin_ctzll(res) >> 3);
+            if (eq(key, elem + j * elem_size(ht))) {
+                return elem + j * elem_size(ht) + ht->key_size;
+            }
+            res &= res - 1;
+        }
+
+        if ((((controlv ^ emptyv) - onev) & ~(controlv ^ emptyv)) & bound) {
+            return 0;
+        }
+    }
+
+#endif
+
+    return 0;
+}
+
+uint32_t deletecb_hashed_elem_ht(HashTable *ht, const void *key,
+                                 int eq(const void *key, const void *elem_key),
+                                 void callback(void *value)) {
+    uint8_t *control = ht->elems;
+    uint8_t *elem = ht->elems + calc_control_size(ht->capacity);
+
+    uint64_t keyhash = *(uint64_t *)key;
+    uint64_t hi = keyhash & 0xFE00000000000000ull;
+    uint64_t lo = keyhash ^ hi;
+    hi >>= 57;
+
+#ifdef __SSE2__
+    const __m128i emptyv = _mm_set1_epi8(0x80);
+    __m128i hiv = _mm_set1_epi8(hi);
+    for (size_t i = lo & (ht->capacity - 1); i < ht->capacity;
+         i += GROUP_SIZE) {
+        __m128i controlv = _mm_loadu_si128((__m128i *)(control + i));
+        int bound = calc_group_bound(ht->capacity, i);
+        int res = _mm_movemask_epi8(_mm_cmpeq_epi8(hiv, controlv)) & bound;
+        while (res) {
+            size_t j = i + __builtin_ctz(res);
+            if (eq(key, elem + j * elem_size(ht))) {
+                callback(elem + j * elem_size(ht) + ht->key_size);
+                control[j] = 0xFE;
+                ht->length -= 1;
+                return 1;
+            }
+            res &= res - 1;
+        }
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(controlv, emptyv)) & bound) {
+            return 0;
+        }
+    }
+
+#else // SWAR
+    const uint64_t emptyv = 0x8080808080808080ull;
+    const uint64_t onev = 0x0101010101010101ull;
+    uint64_t hiv = onev * hi;
+    for (size_t i = lo & (ht->capacity - 1); i < ht->capacity;
+         i += GROUP_SIZE) {
+        uint64_t controlv = *(uint64_t *)(control + i);
+        uint64_t bound = calc_group_bound(ht->capacity, i);
+        uint64_t res = (((hiv ^ controlv) - onev) & ~(hiv ^ controlv)) &
+                       0x8080808080808080ull & bound;
+        while (res) {
+            size_t j = i + (__builtin_ctzll(res) >> 3);
+            if (eq(key, elem + j * elem_size(ht))) {
+                callback(elem + j * elem_size(ht) + ht->key_size);
+                control[j] = 0xFE;
+                ht->length -= 1;
+                return 1;
+            }
+            res &= res - 1;
+        }
+
+        if ((((controlv ^ emptyv) - onev) & ~(controlv ^ emptyv)) & bound) {
             return 0;
         }
     }
@@ -395,6 +641,44 @@ uint32_t put_elem_dht(HashTable **dht, const void *key, const void *value) {
     return ret;
 }
 
+HashTable *realloc_hashed_dht(HashTable *old_dht, const size_t new_len,
+                              int eq(const void *key, const void *elem_key)) {
+    HashTable *new_dht =
+        create_dht(new_len, old_dht->key_size, old_dht->val_size);
+
+    Entry entry;
+    size_t idx = 0;
+    while ((entry = next_elem_ht(old_dht, &idx)).key) {
+        put_hashed_elem_ht(new_dht, entry.key, entry.value, eq);
+    }
+
+    free(old_dht);
+
+    return new_dht;
+}
+
+uint32_t put_hashed_elem_dht(HashTable **dht, const void *key,
+                             const void *value,
+                             int eq(const void *key, const void *elem_key)) {
+    uint32_t ret = put_hashed_elem_ht(*dht, key, value, eq);
+    if (!ret) {
+        *dht = realloc_hashed_dht(*dht, (*dht)->capacity << 1, eq);
+        return put_hashed_elem_dht(dht, key, value, eq);
+    }
+    return ret;
+}
+
+void *get_hashed_elem_dht(HashTable *dht, const void *key,
+                          int eq(const void *key, const void *elem_key)) {
+    return get_hashed_elem_ht(dht, key, eq);
+}
+
+uint32_t deletecb_hashed_elem_dht(HashTable *dht, const void *key,
+                                  int eq(const void *key, const void *elem_key),
+                                  void callback(void *value)) {
+    return deletecb_hashed_elem_ht(dht, key, eq, callback);
+}
+
 void *get_elem_dht(HashTable *dht, const void *key) {
     return get_elem_ht(dht, key);
 }
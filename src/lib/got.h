@@ -27,6 +27,9 @@ uint64_t power_of_two(uint64_t x);
 // Same interface is expected
 uint64_t fnv1a_hash(const uint8_t *input, const size_t length);
 
+// Same interface, but mixes 8 bytes at a time for long inputs
+uint64_t word_hash(const uint8_t *input, const size_t length);
+
 // TODO: Consider adding specialized tables for strings and integers
 typedef struct HashTable {
     size_t key_size;
@@ -71,6 +74,22 @@ uint32_t delete_elem_ht(HashTable *ht, const void *key);
 uint32_t deletecb_elem_ht(HashTable *ht, const void *key,
                           void callback(void *value));
 
+// Variants for keys that cannot be compared bytewise, e.g. spans of strings.
+// The key must begin with its own precomputed `uint64_t` hash,
+// which is used in place of hashing the whole key.
+// `eq` compares `key` with a stored `elem_key` whose control byte matched.
+uint32_t put_hashed_elem_ht(HashTable *ht, const void *key, const void *value,
+                            int eq(const void *key, const void *elem_key));
+
+// `get_elem_ht` for keys with a precomputed hash, see `put_hashed_elem_ht`.
+void *get_hashed_elem_ht(HashTable *ht, const void *key,
+                         int eq(const void *key, const void *elem_key));
+
+// `deletecb_elem_ht` for keys with a precomputed hash.
+uint32_t deletecb_hashed_elem_ht(HashTable *ht, const void *key,
+                                 int eq(const void *key, const void *elem_key),
+                                 void callback(void *value));
+
 // Get the first live entry from the table starting at `idx`.
 // Returns pointers to key and value.
 // Both pointers will be set to 0 when finished (invalid `idx`).
@@ -94,6 +113,20 @@ uint32_t put_elem_dht(HashTable **dht, const void *key, const void *value);
 // `get_elem_ht` dynamic variant, identical behaviour.
 void *get_elem_dht(HashTable *dht, const void *key);
 
+// `put_hashed_elem_ht` dynamic variant, mallocs and frees as necessary.
+uint32_t put_hashed_elem_dht(HashTable **dht, const void *key,
+                             const void *value,
+                             int eq(const void *key, const void *elem_key));
+
+// `get_hashed_elem_ht` dynamic variant, identical behaviour.
+void *get_hashed_elem_dht(HashTable *dht, const void *key,
+                          int eq(const void *key, const void *elem_key));
+
+// `deletecb_hashed_elem_ht` dynamic variant, identical behaviour.
+uint32_t deletecb_hashed_elem_dht(HashTable *dht, const void *key,
+                                  int eq(const void *key, const void *elem_key),
+                                  void callback(void *value));
+
 // `delete_elem_ht` dynamic variant, identical behaviour.
 // Note that if table expands the tombstones will be deleted completely.
 uint32_t delete_elem_dht(HashTable *dht, const void *key);
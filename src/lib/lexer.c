@@ -2,7 +2,10 @@
    License, v. 2.0. If a copy of the MPL was not distributed with this
    file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include "lexer.h"
-#include <math.h>
+#include "fpconv.h"
+#include "scan.h"
+#include "stats.h"
+#include "xid.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -63,6 +66,152 @@ uint8_t key_len_table[KEY_COUNT] = {
     [KEY__Noreturn] = 9,
 };
 
+const char *key_str_table[KEY_COUNT] = {
+    [KEY_alignas] = "alignas",
+    [KEY_alignof] = "alignof",
+    [KEY_auto] = "auto",
+    [KEY_bool] = "bool",
+    [KEY_break] = "break",
+    [KEY_case] = "case",
+    [KEY_char] = "char",
+    [KEY_const] = "const",
+    [KEY_constexpr] = "constexpr",
+    [KEY_continue] = "continue",
+    [KEY_default] = "default",
+    [KEY_do] = "do",
+    [KEY_double] = "double",
+    [KEY_else] = "else",
+    [KEY_enum] = "enum",
+    [KEY_extern] = "extern",
+    [KEY_false] = "false",
+    [KEY_float] = "float",
+    [KEY_for] = "for",
+    [KEY_goto] = "goto",
+    [KEY_if] = "if",
+    [KEY_inline] = "inline",
+    [KEY_int] = "int",
+    [KEY_long] = "long",
+    [KEY_nullptr] = "nullptr",
+    [KEY_register] = "register",
+    [KEY_restrict] = "restrict",
+    [KEY_return] = "return",
+    [KEY_short] = "short",
+    [KEY_signed] = "signed",
+    [KEY_sizeof] = "sizeof",
+    [KEY_static] = "static",
+    [KEY_static_assert] = "static_assert",
+    [KEY_struct] = "struct",
+    [KEY_switch] = "switch",
+    [KEY_thread_local] = "thread_local",
+    [KEY_true] = "true",
+    [KEY_typedef] = "typedef",
+    [KEY_typeof] = "typeof",
+    [KEY_typeof_unqual] = "typeof_unqual",
+    [KEY_union] = "union",
+    [KEY_unsigned] = "unsigned",
+    [KEY_void] = "void",
+    [KEY_volatile] = "volatile",
+    [KEY_while] = "while",
+    [KEY__Atomic] = "_Atomic",
+    [KEY__BitInt] = "_BitInt",
+    [KEY__Complex] = "_Complex",
+    [KEY__Decimal128] = "_Decimal128",
+    [KEY__Decimal32] = "_Decimal32",
+    [KEY__Decimal64] = "_Decimal64",
+    [KEY__Generic] = "_Generic",
+    [KEY__Imaginary] = "_Imaginary",
+    [KEY__Noreturn] = "_Noreturn",
+};
+
+// Perfect hash of the keywords, bits of their word_hash where no two of
+// them share a slot
+#define KEY_SLOT(hash) (((hash) >> 42) & 511)
+
+// Keyword + 1 by the KEY_SLOT of its hash, where 0 is an empty slot.
+// Filled from key_str_table by fill_key_slots.
+uint8_t key_slot_table[512];
+
+// Runs before main, so a change to word_hash or KEY_SLOT that makes two
+// keywords share a slot stops every run rather than lexing one as an id
+__attribute__((constructor)) void fill_key_slots(void) {
+    for (size_t key = 0; key < KEY_COUNT; key++) {
+        const char *name = key_str_table[key];
+        size_t len = strlen(name);
+        uint64_t slot = KEY_SLOT(word_hash((const uint8_t *)name, len));
+        if (len != key_len_table[key] || key_slot_table[slot]) {
+            fprintf(stderr, "Keyword \"%s\" does not get a slot of its own, "
+                            "see KEY_SLOT\n",
+                    name);
+            abort();
+        }
+        key_slot_table[slot] = key + 1;
+    }
+}
+
+uint8_t macro_len_table[IncludeNext + 1] = {
+    [Include] = 7,
+    [Define] = 6,
+    [Undefine] = 5,
+    [If] = 2,
+    [IfDefined] = 5,
+    [IfNotDefined] = 6,
+    [Else] = 4,
+    [ElseIf] = 4,
+    [ElseIfDefined] = 7,
+    [ElseIfNotDefined] = 8,
+    [EndIf] = 5,
+    [Line] = 4,
+    [Embed] = 5,
+    [Error] = 5,
+    [Warning] = 7,
+    [Pragma] = 6,
+    [IncludeNext] = 12,
+};
+
+const char *macro_str_table[IncludeNext + 1] = {
+    [Include] = "include",
+    [Define] = "define",
+    [Undefine] = "undef",
+    [If] = "if",
+    [IfDefined] = "ifdef",
+    [IfNotDefined] = "ifndef",
+    [Else] = "else",
+    [ElseIf] = "elif",
+    [ElseIfDefined] = "elifdef",
+    [ElseIfNotDefined] = "elifndef",
+    [EndIf] = "endif",
+    [Line] = "line",
+    [Embed] = "embed",
+    [Error] = "error",
+    [Warning] = "warning",
+    [Pragma] = "pragma",
+    [IncludeNext] = "include_next",
+};
+
+// Perfect hash of the directive names, no two of them share a slot
+#define MACRO_SLOT(len, first, last) ((((first) + (last)) * 7 + (len)) & 31)
+
+// Directive by its MACRO_SLOT, where InvalidMacro is an empty slot
+const uint8_t macro_slot_table[32] = {
+    [MACRO_SLOT(7, 'i', 'e')] = Include,
+    [MACRO_SLOT(6, 'd', 'e')] = Define,
+    [MACRO_SLOT(5, 'u', 'f')] = Undefine,
+    [MACRO_SLOT(2, 'i', 'f')] = If,
+    [MACRO_SLOT(5, 'i', 'f')] = IfDefined,
+    [MACRO_SLOT(6, 'i', 'f')] = IfNotDefined,
+    [MACRO_SLOT(4, 'e', 'e')] = Else,
+    [MACRO_SLOT(4, 'e', 'f')] = ElseIf,
+    [MACRO_SLOT(7, 'e', 'f')] = ElseIfDefined,
+    [MACRO_SLOT(8, 'e', 'f')] = ElseIfNotDefined,
+    [MACRO_SLOT(5, 'e', 'f')] = EndIf,
+    [MACRO_SLOT(4, 'l', 'e')] = Line,
+    [MACRO_SLOT(5, 'e', 'd')] = Embed,
+    [MACRO_SLOT(5, 'e', 'r')] = Error,
+    [MACRO_SLOT(7, 'w', 'g')] = Warning,
+    [MACRO_SLOT(6, 'p', 'a')] = Pragma,
+    [MACRO_SLOT(12, 'i', 't')] = IncludeNext,
+};
+
 int nondigit(char c) {
     return ((c == '_') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'));
 }
@@ -75,288 +224,228 @@ int hex_digit(char c) {
 }
 int bin_digit(char c) { return c == '0' || c == '1'; }
 int nonzero(char c) { return c >= '1' && c <= '9'; }
-uint64_t acquire(char c) { return c - '0'; }
-uint64_t hex_acquire(char c) {
-    if (digit(c)) {
-        return c - '0';
-    } else if (c >= 'a') {
-        return c - 'a';
+
+// Value of a digit in bases up to 16, anything else is 0xFF
+const uint8_t digit_value_table[256] = {
+    [0 ... 255] = 0xFF,
+    ['0'] = 0,  ['1'] = 1,  ['2'] = 2,  ['3'] = 3,  ['4'] = 4,  ['5'] = 5,
+    ['6'] = 6,  ['7'] = 7,  ['8'] = 8,  ['9'] = 9,  ['a'] = 10, ['b'] = 11,
+    ['c'] = 12, ['d'] = 13, ['e'] = 14, ['f'] = 15, ['A'] = 10, ['B'] = 11,
+    ['C'] = 12, ['D'] = 13, ['E'] = 14, ['F'] = 15,
+};
+
+#define SWAR_ONES 0x0101010101010101ull
+
+// 0x80 in every byte of `v` that is within [lo, hi], for lo, hi < 0x80
+uint64_t swar_bytes_in(uint64_t v, uint8_t lo, uint8_t hi) {
+    uint64_t low = v & (SWAR_ONES * 0x7F);
+    return (low + SWAR_ONES * (0x80 - lo)) & ~(low + SWAR_ONES * (0x7F - hi)) &
+           ~v & (SWAR_ONES * 0x80);
+}
+
+// Value of the up to 8 leading digits of `base` at `input`, read at once.
+// Returns how many digits there were, the first is the most significant.
+size_t swar_digits(const char *input, uint64_t base, uint64_t *value) {
+    uint64_t v;
+    memcpy(&v, input, 8);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+
+    uint64_t valid, d;
+    if (base == 16) {
+        uint64_t alpha = swar_bytes_in(v | (SWAR_ONES * 0x20), 'a', 'f');
+        valid = swar_bytes_in(v, '0', '9') | alpha;
+        d = (v & (SWAR_ONES * 0x0F)) + (alpha >> 7) * 9;
     } else {
-        return c - 'A';
+        valid = swar_bytes_in(v, '0', '0' + base - 1);
+        d = v - SWAR_ONES * '0';
+    }
+
+    uint64_t invalid = ~valid & (SWAR_ONES * 0x80);
+    size_t count = invalid ? __builtin_ctzll(invalid) >> 3 : 8;
+    if (!count) {
+        return 0;
+    }
+
+    // Only keep the digits, moved up so the bytes below are leading zeros
+    d <<= (8 - count) * 8;
+
+    // Pairs of digits, then pairs of pairs and so on, each lane fits
+    d = (d & 0x00FF00FF00FF00FFull) * base + ((d >> 8) & 0x00FF00FF00FF00FFull);
+    d = (d & 0x0000FFFF0000FFFFull) * (base * base) +
+        ((d >> 16) & 0x0000FFFF0000FFFFull);
+    *value = (d & 0xFFFFFFFF) * (base * base * base * base) + (d >> 32);
+    return count;
+}
+
+const uint64_t pow10_table[9] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+};
+
+// Accumulates digits of `base` starting at `input[*len]` onto `constant`,
+// skipping ' separators between them. Sets `overflow` past 64 bits.
+// `limit` is how many bytes can be read from `input`.
+uint64_t integer_digits(const char *input, size_t *len, size_t limit,
+                        uint64_t base, uint64_t constant, int *overflow) {
+    for (;;) {
+        uint64_t chunk;
+        size_t count;
+        if (*len + 8 <= limit &&
+            (count = swar_digits(input + *len, base, &chunk))) {
+            uint64_t scale = base == 10
+                                 ? pow10_table[count]
+                                 : 1ull << (__builtin_ctzll(base) * count);
+            *overflow |= __builtin_mul_overflow(constant, scale, &constant);
+            *overflow |= __builtin_add_overflow(constant, chunk, &constant);
+            *len += count;
+            if (count == 8) {
+                continue;
+            }
+        } else if (digit_value_table[(uint8_t)input[*len]] < base) {
+            *overflow |= __builtin_mul_overflow(constant, base, &constant);
+            *overflow |= __builtin_add_overflow(
+                constant, digit_value_table[(uint8_t)input[*len]], &constant);
+            *len += 1;
+            continue;
+        }
+
+        if (input[*len] == '\'' &&
+            digit_value_table[(uint8_t)input[*len + 1]] < base) {
+            *len += 1;
+        } else {
+            return constant;
+        }
     }
 }
 
+// Class of the first byte of a token, lets lex_next go to the sub-lexer.
+// NOTE: Order is important, CC_Nondigit to CC_Digit make up an identifier.
+enum char_class {
+    CC_Illegal = 0,
+    CC_Space,
+    CC_Newline,
+    CC_Backslash,
+    CC_Nondigit,
+    CC_Prefix, // u, U, L, also may start a char or string literal
+    CC_Digit,
+    CC_Dot, // Also may start a float
+    CC_Quote,
+    CC_DoubleQuote,
+    CC_Slash, // Also may start a comment
+    CC_Punct,
+    CC_Utf8, // Past ASCII, may start an identifier
+};
+
+const uint8_t char_class_table[256] = {
+    [' '] = CC_Space,
+    ['\t'] = CC_Space,
+    ['\r'] = CC_Space,
+    ['\n'] = CC_Newline,
+    ['\\'] = CC_Backslash,
+    ['a' ... 'z'] = CC_Nondigit,
+    ['A' ... 'Z'] = CC_Nondigit,
+    ['_'] = CC_Nondigit,
+    ['u'] = CC_Prefix,
+    ['U'] = CC_Prefix,
+    ['L'] = CC_Prefix,
+    ['0' ... '9'] = CC_Digit,
+    ['.'] = CC_Dot,
+    ['\''] = CC_Quote,
+    ['"'] = CC_DoubleQuote,
+    ['/'] = CC_Slash,
+    ['['] = CC_Punct,
+    [']'] = CC_Punct,
+    ['('] = CC_Punct,
+    [')'] = CC_Punct,
+    ['{'] = CC_Punct,
+    ['}'] = CC_Punct,
+    ['&'] = CC_Punct,
+    ['*'] = CC_Punct,
+    ['+'] = CC_Punct,
+    ['-'] = CC_Punct,
+    ['~'] = CC_Punct,
+    ['!'] = CC_Punct,
+    ['%'] = CC_Punct,
+    ['<'] = CC_Punct,
+    ['>'] = CC_Punct,
+    ['^'] = CC_Punct,
+    ['|'] = CC_Punct,
+    ['?'] = CC_Punct,
+    [':'] = CC_Punct,
+    [';'] = CC_Punct,
+    ['='] = CC_Punct,
+    [','] = CC_Punct,
+    ['#'] = CC_Punct,
+    [0x80 ... 0xFF] = CC_Utf8,
+};
+
 int nondigit_or_digit(char c) {
-    return ((c == '_') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
-            (c >= '0' && c <= '9'));
+    uint8_t class = char_class_table[(uint8_t)c];
+    return class >= CC_Nondigit && class <= CC_Digit;
 }
 
-int punctuation(char c) {
-    return c == '[' || c == ']' || c == '(' || c == ')' || c == '{' ||
-           c == '}' || c == '.' || c == '&' || c == '*' || c == '+' ||
-           c == '-' || c == '~' || c == '!' || c == '/' || c == '%' ||
-           c == '<' || c == '>' || c == '^' || c == '|' || c == '?' ||
-           c == ':' || c == ';' || c == '=' || c == ',' || c == '#';
+int id_key_eq(const void *key, const void *elem_key) {
+    const IdKey *a = key;
+    const IdKey *b = elem_key;
+    return a->hash == b->hash && a->len == b->len &&
+           !memcmp(a->start, b->start, a->len);
 }
 
-int space(char c) { return c == ' ' || c == '\n' || c == '\t' || c == '\r'; }
+size_t search_id_table(const Span span, Ids *id_table) {
+    return search_hashed_id(
+        span, word_hash((uint8_t *)span.start, span.len), id_table);
+}
 
-// Check if this id already exists, else push it on
-size_t search_id_table(const Span span, Ids **id_table) {
-    for (size_t i = 0; i < (*id_table)->length; i++) {
-        Span id = *(Span *)at_elem_vec(*id_table, i);
-        if (span.len == id.len && !memcmp(id.start, span.start, span.len)) {
-            return i;
-        }
+size_t search_hashed_id(const Span span, uint64_t hash, Ids *id_table) {
+    IdKey key = {hash, span.start, span.len};
+    size_t *id = get_hashed_elem_dht(id_table->index, &key, id_key_eq);
+    STAT_ADD(id_lookups, 1);
+    if (id) {
+        STAT_ADD(id_hits, 1);
+        return *id;
     }
-    push_elem_vec(id_table, &span);
-    return (*id_table)->length - 1;
+    size_t new_id = id_table->spans->length;
+    push_elem_vec(&id_table->spans, &span);
+    push_elem_vec(&id_table->hashes, &hash);
+    put_hashed_elem_dht(&id_table->index, &key, &new_id, id_key_eq);
+    return new_id;
 }
 
-Lex check_keyword(const Span span) {
-    if (span.len < 2 || span.len > 13) {
-        return (Lex){0};
+size_t search_decoded_id(const Span span, uint64_t hash, Ids *id_table) {
+    IdKey key = {hash, span.start, span.len};
+    size_t *id = get_hashed_elem_dht(id_table->index, &key, id_key_eq);
+    if (id) {
+        return *id;
     }
-    switch (*span.start) {
-    case 'a':
-        if (span.len == key_len_table[KEY_auto] &&
-            !memcmp("auto", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_auto};
-        } else if (span.len == key_len_table[KEY_alignas] &&
-                   !memcmp("alignas", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_alignas};
-        } else if (span.len == key_len_table[KEY_alignof] &&
-                   !memcmp("alignof", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_alignof};
-        }
-        break;
-    case 'b':
-        if (span.len == key_len_table[KEY_break] &&
-            !memcmp("break", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_break};
-        } else if (span.len == key_len_table[KEY_bool] &&
-                   !memcmp("bool", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_bool};
-        }
-        break;
-    case 'c':
-        if (span.len < 4 || span.len > 9) {
-            break;
-        } else if (span.len == key_len_table[KEY_continue] &&
-                   !memcmp("continue", span.start, span.len)) {
-            return (Lex){
-                .type = LEX_Keyword, .span = span, .key = KEY_continue};
-        } else if (span.len == key_len_table[KEY_constexpr] &&
-                   !memcmp("constexpr", span.start, span.len)) {
-            return (Lex){
-                .type = LEX_Keyword, .span = span, .key = KEY_constexpr};
-        } else if (span.len == key_len_table[KEY_const] &&
-                   !memcmp("const", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_const};
-        } else if (span.len == key_len_table[KEY_char] &&
-                   !memcmp("char", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_char};
-        } else if (span.len == key_len_table[KEY_case] &&
-                   !memcmp("case", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_case};
-        }
-        break;
-    case 'd':
-        if (span.len == key_len_table[KEY_do] &&
-            !memcmp("do", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_do};
-        } else if (span.len == key_len_table[KEY_double] &&
-                   !memcmp("double", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_double};
-        } else if (span.len == key_len_table[KEY_default] &&
-                   !memcmp("default", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_default};
-        }
-        break;
-    case 'e':
-        if (span.len == key_len_table[KEY_extern] &&
-            !memcmp("extern", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_extern};
-        } else if (span.len == key_len_table[KEY_enum] &&
-                   !memcmp("enum", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_enum};
-        } else if (span.len == key_len_table[KEY_else] &&
-                   !memcmp("else", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_else};
-        }
-        break;
-    case 'f':
-        if (span.len == key_len_table[KEY_for] &&
-            !memcmp("for", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_for};
-        } else if (span.len == key_len_table[KEY_float] &&
-                   !memcmp("float", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_float};
-        } else if (span.len == key_len_table[KEY_false] &&
-                   !memcmp("false", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_false};
-        }
-        break;
-    case 'g':
-        if (span.len == key_len_table[KEY_goto] &&
-            !memcmp("goto", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_goto};
-        }
-        break;
-    case 'i':
-        if (span.len == key_len_table[KEY_int] &&
-            !memcmp("int", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_int};
-        } else if (span.len == key_len_table[KEY_inline] &&
-                   !memcmp("inline", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_inline};
-        } else if (span.len == key_len_table[KEY_if] &&
-                   !memcmp("if", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_if};
-        }
-        break;
-    case 'l':
-        if (span.len == key_len_table[KEY_long] &&
-            !memcmp("long", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_long};
-        }
-        break;
-    case 'n':
-        if (span.len == key_len_table[KEY_nullptr] &&
-            !memcmp("nullptr", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_nullptr};
-        }
-        break;
-    case 'r':
-        if (span.len == key_len_table[KEY_return] &&
-            !memcmp("return", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_return};
-        } else if (span.len == key_len_table[KEY_restrict] &&
-                   !memcmp("restrict", span.start, span.len)) {
-            return (Lex){
-                .type = LEX_Keyword, .span = span, .key = KEY_restrict};
-        } else if (span.len == key_len_table[KEY_register] &&
-                   !memcmp("register", span.start, span.len)) {
-            return (Lex){
-                .type = LEX_Keyword, .span = span, .key = KEY_register};
-        }
-        break;
-    case 's':
-        if (span.len < 5) {
-            break;
-        } else if (span.len == key_len_table[KEY_switch] &&
-                   !memcmp("switch", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_switch};
-        } else if (span.len == key_len_table[KEY_struct] &&
-                   !memcmp("struct", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_struct};
-        } else if (span.len == key_len_table[KEY_static_assert] &&
-                   !memcmp("static_assert", span.start, span.len)) {
-            return (Lex){
-                .type = LEX_Keyword, .span = span, .key = KEY_static_assert};
-        } else if (span.len == key_len_table[KEY_static] &&
-                   !memcmp("static", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_static};
-        } else if (span.len == key_len_table[KEY_sizeof] &&
-                   !memcmp("sizeof", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_sizeof};
-        } else if (span.len == key_len_table[KEY_signed] &&
-                   !memcmp("signed", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_signed};
-        } else if (span.len == key_len_table[KEY_short] &&
-                   !memcmp("short", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_short};
-        }
-        break;
-    case 't':
-        if (span.len < 4) {
-            break;
-        } else if (span.len == key_len_table[KEY_typeof_unqual] &&
-                   !memcmp("typeof_unqual", span.start, span.len)) {
-            return (Lex){
-                .type = LEX_Keyword, .span = span, .key = KEY_typeof_unqual};
-        } else if (span.len == key_len_table[KEY_typeof] &&
-                   !memcmp("typeof", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_typeof};
-        } else if (span.len == key_len_table[KEY_typedef] &&
-                   !memcmp("typedef", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_typedef};
-        } else if (span.len == key_len_table[KEY_true] &&
-                   !memcmp("true", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_true};
-        } else if (span.len == key_len_table[KEY_thread_local] &&
-                   !memcmp("thread_local", span.start, span.len)) {
-            return (Lex){
-                .type = LEX_Keyword, .span = span, .key = KEY_thread_local};
-        }
-        break;
-    case 'u':
-        if (span.len == key_len_table[KEY_union] &&
-            !memcmp("union", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_union};
-        } else if (span.len == key_len_table[KEY_unsigned] &&
-                   !memcmp("unsigned", span.start, span.len)) {
-            return (Lex){
-                .type = LEX_Keyword, .span = span, .key = KEY_unsigned};
-        }
-        break;
-    case 'v':
-        if (span.len == key_len_table[KEY_void] &&
-            !memcmp("void", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_void};
-        } else if (span.len == key_len_table[KEY_volatile] &&
-                   !memcmp("volatile", span.start, span.len)) {
-            return (Lex){
-                .type = LEX_Keyword, .span = span, .key = KEY_volatile};
-        }
-        break;
-    case 'w':
-        if (span.len == key_len_table[KEY_while] &&
-            !memcmp("while", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY_while};
-        }
-        break;
-    case '_':
-        if (span.len < 7 || span.len > 11) {
-            break;
-        } else if (span.len == key_len_table[KEY__Noreturn] &&
-                   !memcmp("_Noreturn", span.start, span.len)) {
-            return (Lex){
-                .type = LEX_Keyword, .span = span, .key = KEY__Noreturn};
-        } else if (span.len == key_len_table[KEY__Imaginary] &&
-                   !memcmp("_Imaginary", span.start, span.len)) {
-            return (Lex){
-                .type = LEX_Keyword, .span = span, .key = KEY__Imaginary};
-        } else if (span.len == key_len_table[KEY__Generic] &&
-                   !memcmp("_Generic", span.start, span.len)) {
-            return (Lex){
-                .type = LEX_Keyword, .span = span, .key = KEY__Generic};
-        } else if (span.len == key_len_table[KEY__Decimal32] &&
-                   !memcmp("_Decimal32", span.start, span.len)) {
-            return (Lex){
-                .type = LEX_Keyword, .span = span, .key = KEY__Decimal32};
-        } else if (span.len == key_len_table[KEY__Decimal64] &&
-                   !memcmp("_Decimal64", span.start, span.len)) {
-            return (Lex){
-                .type = LEX_Keyword, .span = span, .key = KEY__Decimal64};
-        } else if (span.len == key_len_table[KEY__Decimal128] &&
-                   !memcmp("_Decimal128", span.start, span.len)) {
-            return (Lex){
-                .type = LEX_Keyword, .span = span, .key = KEY__Decimal128};
-        } else if (span.len == key_len_table[KEY__Complex] &&
-                   !memcmp("_Complex", span.start, span.len)) {
-            return (Lex){
-                .type = LEX_Keyword, .span = span, .key = KEY__Complex};
-        } else if (span.len == key_len_table[KEY__BitInt] &&
-                   !memcmp("_BitInt", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY__BitInt};
-        } else if (span.len == key_len_table[KEY__Atomic] &&
-                   !memcmp("_Atomic", span.start, span.len)) {
-            return (Lex){.type = LEX_Keyword, .span = span, .key = KEY__Atomic};
-        }
-        break;
-    default:
-        break;
+    char *text = malloc(span.len);
+    memcpy(text, span.start, span.len);
+    push_elem_vec(&id_table->decoded, &text);
+    return search_hashed_id((Span){text, span.len}, hash, id_table);
+}
+
+uint64_t id_hash(const Ids *id_table, size_t id) {
+    return *(uint64_t *)at_elem_vec(id_table->hashes, id);
+}
+
+size_t search_literals(const Span span, Literals *literals) {
+    IdKey key = {word_hash((uint8_t *)span.start, span.len), span.start,
+                 span.len};
+    size_t *id = get_hashed_elem_dht(literals->index, &key, id_key_eq);
+    if (id) {
+        return *id;
+    }
+    size_t new_id = literals->spans->length;
+    push_elem_vec(&literals->spans, &span);
+    put_hashed_elem_dht(&literals->index, &key, &new_id, id_key_eq);
+    return new_id;
+}
+
+Lex check_keyword(const Span span, uint64_t hash, Range range) {
+    uint8_t slot = key_slot_table[KEY_SLOT(hash)];
+    if (slot && span.len == key_len_table[slot - 1] &&
+        !memcmp(key_str_table[slot - 1], span.start, span.len)) {
+        return (Lex){.type = LEX_Keyword, .span = range, .key = slot - 1};
     }
     return (Lex){0};
 }
@@ -369,106 +458,356 @@ uint32_t check_string_prefix(const Span span) {
              (span.start[1] == '\'' || span.start[1] == '"')));
 }
 
-// MINOR: Possibly handle XID_Start and XID_Continue
-Lex keyword_or_id(const Stream *stream, Vector **id_table) {
-    if (nondigit(stream->start[stream->idx])) {
-        char *input = (char *)stream->start + stream->idx;
-        size_t len = 1;
-
-        while (nondigit_or_digit(input[len])) {
-            len += 1;
+// Value of the universal character name at `input`, \\u and 4 hex digits
+// or \\U and 8. Returns its length, 0 if there is none or C23 does not
+// allow one for that code point.
+size_t ucn(const char *input, uint32_t *c) {
+    size_t len = input[1] == 'u' ? 6 : input[1] == 'U' ? 10 : 0;
+    if (input[0] != '\\' || !len) {
+        return 0;
+    }
+    *c = 0;
+    for (size_t i = 2; i < len; i++) {
+        uint8_t value = digit_value_table[(uint8_t)input[i]];
+        if (value > 15) {
+            return 0;
         }
+        *c = *c << 4 | value;
+    }
+    if ((*c < 0xA0 && *c != '$' && *c != '@' && *c != '`') ||
+        (*c >= 0xD800 && *c <= 0xDFFF) || *c > 0x10FFFF) {
+        return 0;
+    }
+    return len;
+}
 
-        Span span = {input, len, stream->row, stream->col};
-        Lex keyword = check_keyword(span);
-        if (keyword.type) {
-            return keyword;
+// Value of the escape sequence at `input` other than a UCN, a simple one,
+// up to 3 octal digits, or \\x and any number of hex digits.
+// Returns its length, 0 if there is none or its value is over 32 bits.
+size_t escape(const char *input, uint32_t *c) {
+    static const char simple[256] = {
+        ['\''] = '\'', ['"'] = '"',  ['?'] = '?',  ['\\'] = '\\',
+        ['a'] = '\a',  ['b'] = '\b', ['f'] = '\f', ['n'] = '\n',
+        ['r'] = '\r',  ['t'] = '\t', ['v'] = '\v',
+    };
+    if (input[0] != '\\') {
+        return 0;
+    } else if (simple[(uint8_t)input[1]]) {
+        *c = simple[(uint8_t)input[1]];
+        return 2;
+    }
+
+    uint64_t value = 0;
+    size_t len = 1;
+    if (input[1] == 'x') {
+        // Stops at the first digit too many, so it cannot overflow
+        for (len = 2; hex_digit(input[len]) && value <= UINT32_MAX; len++) {
+            value = value << 4 | digit_value_table[(uint8_t)input[len]];
+        }
+        if (len == 2 || value > UINT32_MAX) {
+            return 0;
+        }
+    } else {
+        for (; len < 4 && oct_digit(input[len]); len++) {
+            value = value * 8 + (input[len] - '0');
+        }
+        if (len == 1) {
+            return 0;
         }
+    }
+    *c = value;
+    return len;
+}
+
+// Bytes of a code unit of a char constant or string of `type`
+size_t unit_size(enum lex_type type) {
+    switch (type) {
+    case LEX_ConstantCharU16:
+    case LEX_StringU16:
+        return 2;
+    case LEX_ConstantCharU32:
+    case LEX_ConstantCharWide:
+    case LEX_StringU32:
+    case LEX_StringWide:
+        // wchar_t is 32 bits on the targets dfcc knows
+        return 4;
+    default:
+        return 1;
+    }
+}
 
-        if (check_string_prefix(span)) {
-            return (Lex){0};
+// An identifier with characters past ASCII, spelled in UTF-8 or with UCNs,
+// whose first `len` bytes are ASCII already scanned.
+// Ids spelled with UCNs are interned as UTF-8, so both spellings are one id.
+Lex extended_id(const Stream *stream, Ids *id_table, size_t len) {
+    const char *input = stream->start + stream->idx;
+    size_t limit = stream->len - stream->idx;
+    int ucns = 0;
+    for (;;) {
+        len = skip_id_chars(input, len, limit);
+        uint32_t c;
+        size_t n = input[len] == '\\'
+                       ? ucn(input + len, &c)
+                       : decode_utf8(input + len, limit - len, &c);
+        if (!n || c < 0x80 || !(len ? xid_continue(c) : xid_start(c))) {
+            if (!len && n > 1 && input[0] != '\\') {
+                // The whole character is one illegal token
+                return (Lex){.type = LEX_Invalid,
+                             .span = from_stream(stream, n),
+                             .invalid = IllegalToken};
+            }
+            break;
         }
+        ucns |= input[len] == '\\';
+        len += n;
+    }
+    if (!len) {
+        return (Lex){0};
+    }
 
+    Span span = {(char *)input, len};
+    if (!ucns) {
         return (Lex){.type = LEX_Identifier,
-                     .span = span,
-                     .id = search_id_table(span, id_table)};
+                     .span = from_stream(stream, len),
+                     .id = search_hashed_id(
+                         span, word_hash((uint8_t *)input, len), id_table)};
     }
-    return (Lex){0};
+
+    // UTF-8 is never longer than the UCNs it replaces
+    char *text = malloc(len);
+    size_t decoded = 0;
+    for (size_t i = 0; i < len;) {
+        uint32_t c;
+        size_t n = input[i] == '\\' ? ucn(input + i, &c) : 0;
+        if (n) {
+            decoded += encode_utf8(c, text + decoded);
+            i += n;
+        } else {
+            text[decoded++] = input[i++];
+        }
+    }
+    span = (Span){text, decoded};
+    size_t id =
+        search_decoded_id(span, word_hash((uint8_t *)text, decoded), id_table);
+    free(text);
+    return (Lex){.type = LEX_Identifier,
+                 .span = from_stream(stream, len),
+                 .id = id};
+}
+
+Lex keyword_or_id(const Stream *stream, Ids *id_table) {
+    if (!nondigit(stream->start[stream->idx])) {
+        return extended_id(stream, id_table, 0);
+    }
+
+    char *input = (char *)stream->start + stream->idx;
+    size_t len =
+        skip_id_chars(stream->start, stream->idx + 1, stream->len) -
+        stream->idx;
+    if ((uint8_t)input[len] >= 0x80 || input[len] == '\\') {
+        return extended_id(stream, id_table, len);
+    }
+
+    // Hashed once, for the keyword, id and macro lookups
+    Span span = {input, len};
+    uint64_t hash = word_hash((uint8_t *)input, len);
+    Lex keyword = check_keyword(span, hash, from_stream(stream, len));
+    if (keyword.type) {
+        return keyword;
+    }
+
+    if (check_string_prefix(span)) {
+        return (Lex){0};
+    }
+
+    return (Lex){.type = LEX_Identifier,
+                 .span = from_stream(stream, len),
+                 .id = search_hashed_id(span, hash, id_table)};
+}
+
+// Directive named by `len` bytes at `name`, InvalidMacro if there is none
+enum macro_type directive(const char *name, size_t len) {
+    enum macro_type macro = macro_slot_table[MACRO_SLOT(
+        len, (uint8_t)name[0], (uint8_t)name[len - 1])];
+    if (macro && len == macro_len_table[macro] &&
+        !memcmp(macro_str_table[macro], name, len)) {
+        return macro;
+    }
+    return InvalidMacro;
+}
+
+int takes_line(enum macro_type macro) {
+    return macro == Define || macro == If || macro == ElseIf;
+}
+
+// Bytes of the '#' or its digraph "%:" at `input`, 0 if it is neither
+size_t hash_len(const char *input) {
+    if (input[0] == '#') {
+        return 1;
+    }
+    return input[0] == '%' && input[1] == ':' ? 2 : 0;
 }
 
-Lex macro(Stream *stream, Vector **id_table) {
+Lex macro(Stream *stream, Ids *id_table) {
+    size_t hash = hash_len(stream->start + stream->idx);
     if (stream->len > stream->idx) {
-        if (nondigit(stream->start[stream->idx + 1])) {
+        if (nondigit(stream->start[stream->idx + hash])) {
             char *input = (char *)stream->start + stream->idx;
-            size_t len = 2;
+            size_t len = hash + 1;
 
             while (nondigit(input[len])) {
                 len += 1;
             }
 
-            Span span = {input, len, stream->row, stream->col};
-            if (!memcmp("define", span.start + 1, span.len - 1)) {
-                stream->macro_line = Define;
-                return (Lex){
-                    .type = LEX_MacroToken, .span = span, .macro = Define};
-            } else if (!memcmp("include", span.start + 1, span.len - 1)) {
-                return (Lex){
-                    .type = LEX_MacroToken, .span = span, .macro = Include};
-            } else if (!memcmp("if", span.start + 1, span.len - 1)) {
-                stream->macro_line = If;
-                return (Lex){.type = LEX_MacroToken, .span = span, .macro = If};
-            } else if (!memcmp("ifdef", span.start + 1, span.len - 1)) {
-                return (Lex){
-                    .type = LEX_MacroToken, .span = span, .macro = IfDefined};
-            } else if (!memcmp("ifndef", span.start + 1, span.len - 1)) {
-                return (Lex){.type = LEX_MacroToken,
-                             .span = span,
-                             .macro = IfNotDefined};
-            } else if (!memcmp("else", span.start + 1, span.len - 1)) {
-                return (Lex){
-                    .type = LEX_MacroToken, .span = span, .macro = Else};
-            } else if (!memcmp("elif", span.start + 1, span.len - 1)) {
-                stream->macro_line = ElseIf;
-                return (Lex){
-                    .type = LEX_MacroToken, .span = span, .macro = ElseIf};
-            } else if (!memcmp("elifdef", span.start + 1, span.len - 1)) {
-                return (Lex){.type = LEX_MacroToken,
-                             .span = span,
-                             .macro = ElseIfDefined};
-            } else if (!memcmp("elifndef", span.start + 1, span.len - 1)) {
+            enum macro_type macro = directive(input + hash, len - hash);
+            if (macro) {
+                if (takes_line(macro)) {
+                    stream->macro_line = macro;
+                }
                 return (Lex){.type = LEX_MacroToken,
-                             .span = span,
-                             .macro = ElseIfNotDefined};
-            } else if (!memcmp("endif", span.start + 1, span.len - 1)) {
-                return (Lex){
-                    .type = LEX_MacroToken, .span = span, .macro = EndIf};
-            } else if (!memcmp("line", span.start + 1, span.len - 1)) {
-                return (Lex){
-                    .type = LEX_MacroToken, .span = span, .macro = Line};
-            } else if (!memcmp("embed", span.start + 1, span.len - 1)) {
-                return (Lex){
-                    .type = LEX_MacroToken, .span = span, .macro = Embed};
-            } else if (!memcmp("error", span.start + 1, span.len - 1)) {
-                return (Lex){
-                    .type = LEX_MacroToken, .span = span, .macro = Error};
-            } else if (!memcmp("warning", span.start + 1, span.len - 1)) {
-                return (Lex){
-                    .type = LEX_MacroToken, .span = span, .macro = Warning};
-            } else if (!memcmp("pragma", span.start + 1, span.len - 1)) {
-                return (Lex){
-                    .type = LEX_MacroToken, .span = span, .macro = Pragma};
-            } else if (!memcmp("undef", span.start + 1, span.len - 1)) {
-                return (Lex){
-                    .type = LEX_MacroToken, .span = span, .macro = Undefine};
+                             .span = from_stream(stream, len),
+                             .macro = macro};
             }
-        } else if (stream->start[stream->idx + 1] == '#') {
+        } else if (hash == 1 && stream->start[stream->idx + 1] == '#') {
             return (Lex){.type = LEX_HashHash, .span = from_stream(stream, 2)};
         }
     }
-    return (Lex){.type = LEX_Hash, .span = from_stream(stream, 1)};
+    return (Lex){.type = LEX_Hash, .span = from_stream(stream, hash)};
+}
+
+// Skip the rest of a line in a skipped group, with its comments and quotes.
+// Idx after its newline, a block comment can take more lines with it.
+size_t skip_group_line(const char *input, size_t idx, size_t len) {
+    for (;;) {
+        idx = find_group_stop(input, idx, len);
+        if (idx >= len) {
+            return len;
+        }
+
+        char c = input[idx];
+        if (c == '\n') {
+            return idx + 1;
+        } else if (c == '/' && input[idx + 1] == '*') {
+            idx = skip_block_comment(input, idx + 2, len);
+        } else if (c == '/' && input[idx + 1] == '/') {
+            idx = find_newline(input, idx + 2, len);
+        } else if (c == '/') {
+            idx += 1;
+        } else {
+            // Unmatched quotes end with the line, like an apostrophe in text
+            for (idx += 1; input[idx] != c && input[idx] != '\n'; idx++) {
+                if (input[idx] == '\\' && input[idx + 1] != '\n') {
+                    idx += 1;
+                }
+            }
+            if (input[idx] == c) {
+                idx += 1;
+            }
+        }
+    }
 }
 
-Lex punctuator(Stream *stream, Vector **id_table) {
+Lex skip_group(Stream *stream) {
+    const char *input = stream->start;
+    size_t len = stream->len, depth = 0;
+
+    // The directive before the group takes the rest of its line
+    size_t idx = skip_group_line(input, stream->idx, len);
+    stream->macro_line = 0;
+    while (idx < len) {
+        idx = skip_space(input, idx, len, 1);
+        while (input[idx] == '/' && input[idx + 1] == '*') {
+            idx = skip_block_comment(input, idx + 2, len);
+            idx = skip_space(input, idx, len, 0);
+        }
+
+        size_t hash = idx < len ? hash_len(input + idx) : 0;
+        if (hash) {
+            size_t name = skip_space(input, idx + hash, len, 0), end = name;
+            while (nondigit(input[end])) {
+                end += 1;
+            }
+
+            enum macro_type macro =
+                end > name ? directive(input + name, end - name) : InvalidMacro;
+            if (macro >= If && macro <= IfNotDefined) {
+                depth += 1;
+            } else if (macro == EndIf && depth) {
+                depth -= 1;
+            } else if (macro >= Else && macro <= EndIf && !depth) {
+                stream->idx = idx;
+                Lex lex = {.type = LEX_MacroToken,
+                           .span = from_stream(stream, end - idx),
+                           .macro = macro};
+                stream->idx = end;
+                if (takes_line(macro)) {
+                    stream->macro_line = macro;
+                }
+                return lex;
+            }
+            idx = end;
+        }
+        idx = skip_group_line(input, idx, len);
+    }
+
+    stream->idx = len;
+    return (Lex){.type = LEX_Eof};
+}
+
+// Idx of the first byte at or after `idx` that is not space or comment
+size_t skip_blank(const char *input, size_t idx, size_t len) {
+    for (;;) {
+        idx = skip_space(input, idx, len, 1);
+        if (input[idx] == '/' && input[idx + 1] == '*') {
+            idx = skip_block_comment(input, idx + 2, len);
+        } else if (input[idx] == '/' && input[idx + 1] == '/') {
+            idx = find_newline(input, idx + 2, len);
+        } else {
+            return idx;
+        }
+    }
+}
+
+int include_guard(const Stream *stream, Span *name) {
+    const char *input = stream->start;
+    size_t len = stream->len;
+    size_t idx = skip_blank(input, stream->idx, len);
+    size_t hash = idx < len ? hash_len(input + idx) : 0;
+    if (!hash) {
+        return 0;
+    }
+    size_t start = skip_space(input, idx + hash, len, 0), end = start;
+    while (nondigit(input[end])) {
+        end += 1;
+    }
+    if (end == start || directive(input + start, end - start) != IfNotDefined) {
+        return 0;
+    }
+
+    // Only ASCII names, anything else is left to the preprocessor
+    start = skip_space(input, end, len, 0);
+    if (!nondigit(input[start])) {
+        return 0;
+    }
+    end = skip_id_chars(input, start, len);
+    if ((uint8_t)input[end] >= 0x80 || input[end] == '\\') {
+        return 0;
+    }
+
+    // Its #endif must be the last directive, with nothing but comments after
+    Stream local = *stream;
+    local.idx = end;
+    Lex lex = skip_group(&local);
+    if (lex.type != LEX_MacroToken || lex.macro != EndIf ||
+        skip_blank(input, skip_group_line(input, local.idx, len), len) <
+            len) {
+        return 0;
+    }
+    *name = (Span){(char *)input + start, end - start};
+    return 1;
+}
+
+Lex punctuator(Stream *stream, Ids *id_table) {
     switch (stream->start[stream->idx]) {
     case '[':
         return (Lex){.type = LEX_LBracket, .span = from_stream(stream, 1)};
@@ -605,8 +944,23 @@ Lex punctuator(Stream *stream, Vector **id_table) {
     }
 }
 
-// TODO: There is also multibyte chars
-Lex constant_char(const Stream *stream, enum lex_type char_lex) {
+// A char constant of `len` bytes from its quote, for `c` past ASCII.
+// Only those with a prefix for UTF-16 or wider have room for it.
+Lex unicode_char(const Stream *stream, enum lex_type char_lex, size_t offset,
+                 size_t len, uint32_t c, Constants *constants) {
+    if (char_lex == LEX_ConstantChar || char_lex == LEX_ConstantCharU8 ||
+        (char_lex == LEX_ConstantCharU16 && c > 0xFFFF)) {
+        return (Lex){.type = LEX_Invalid,
+                     .span = from_stream_off(stream, -offset, len + offset),
+                     .invalid = IllegalChar};
+    }
+    return (Lex){.type = char_lex,
+                 .span = from_stream_off(stream, -offset, len + offset),
+                 .id = push_constant(constants, c)};
+}
+
+Lex constant_char(const Stream *stream, enum lex_type char_lex,
+                  Constants *constants) {
     size_t offset;
     switch (char_lex) {
     case LEX_ConstantChar:
@@ -626,101 +980,50 @@ Lex constant_char(const Stream *stream, enum lex_type char_lex) {
                      .invalid = IllegalChar};
     }
 
-    if (stream->start[stream->idx + 1] == '\\') {
-        char c;
-        switch (stream->start[stream->idx + 2]) {
-        case '\'':
-            c = 0x27;
-            goto Single_char;
-        case '"':
-            c = 0x22;
-            goto Single_char;
-        case '?':
-            c = 0x3f;
-            goto Single_char;
-        case '\\':
-            c = 0x5c;
-            goto Single_char;
-        case 'a':
-            c = 0x07;
-            goto Single_char;
-        case 'b':
-            c = 0x08;
-            goto Single_char;
-        case 'f':
-            c = 0x0c;
-            goto Single_char;
-        case 'n':
-            c = 0x0a;
-            goto Single_char;
-        case 'r':
-            c = 0x0d;
-            goto Single_char;
-        case 't':
-            c = 0x09;
-            goto Single_char;
-        case 'v':
-            c = 0x0b;
-            goto Single_char;
-        case 'x':
-            // TODO: Arbitrary Hex?
-            break;
-        case 'u':
-        case 'U':
-            // TODO: Handle Universal character name
-            break;
-        default:
-            if (oct_digit(stream->start[stream->idx + 2])) {
-                if (oct_digit(stream->start[stream->idx + 3])) {
-                    if (oct_digit(stream->start[stream->idx + 4]) &&
-                        stream->start[stream->idx + 5] == '\'') {
-                        return (Lex){
-                            .type = char_lex,
-                            .span =
-                                from_stream_off(stream, -offset, 6 + offset),
-                            .constant =
-                                (stream->start[stream->idx + 2] - '0') * 64 +
-                                (stream->start[stream->idx + 3] - '0') * 8 +
-                                (stream->start[stream->idx + 4] - '0')};
-                    } else if (stream->start[stream->idx + 4] == '\'') {
-                        return (Lex){
-                            .type = char_lex,
-                            .span =
-                                from_stream_off(stream, -offset, 5 + offset),
-                            .constant =
-                                (stream->start[stream->idx + 2] - '0') * 8 +
-                                (stream->start[stream->idx + 3] - '0')};
-                    }
-                    return (Lex){
-                        .type = LEX_Invalid,
-                        .span = from_stream_off(stream, -offset, 4 + offset),
-                        .invalid = IllegalEscapeChar};
-                } else if (stream->start[stream->idx + 3] == '\'') {
-                    return (Lex){
-                        .type = char_lex,
-                        .span = from_stream_off(stream, -offset, 4 + offset),
-                        .constant = stream->start[stream->idx + 2] - '0'};
-                }
+    const char *input = stream->start + stream->idx + 1;
+    if (*input == '\\') {
+        uint32_t c;
+        size_t len;
+        if (input[1] == 'u' || input[1] == 'U') {
+            len = ucn(input, &c);
+            if (len && input[len] == '\'') {
+                return unicode_char(stream, char_lex, offset, len + 2, c,
+                                    constants);
+            }
+        } else {
+            // Octal and hex escapes give a code unit, not a code point
+            len = escape(input, &c);
+            uint32_t max = UINT32_MAX >> (32 - 8 * unit_size(char_lex));
+            if (len && c <= max && input[len] == '\'') {
+                return (Lex){.type = char_lex,
+                             .span = from_stream_off(stream, -offset,
+                                                     len + 2 + offset),
+                             .id = push_constant(constants, c)};
+            } else if (len && c <= max) {
+                return (Lex){.type = LEX_Invalid,
+                             .span = from_stream_off(stream, -offset,
+                                                     len + 1 + offset),
+                             .invalid = UnfinishedChar};
             }
         }
         return (Lex){.type = LEX_Invalid,
                      .span = from_stream_off(stream, -offset, 2 + offset),
                      .invalid = IllegalEscapeChar};
-    Single_char:
-        if (stream->start[stream->idx + 3] == '\'') {
-            return (Lex){.type = char_lex,
-                         .span = from_stream_off(stream, -offset, 4 + offset),
-                         .constant = c};
-        }
-        return (Lex){.type = LEX_Invalid,
-                     .span = from_stream_off(stream, -offset, 3 + offset),
-                     .invalid = UnfinishedChar};
     }
 
     if (stream->start[stream->idx + 2] == '\'') {
         return (Lex){.type = char_lex,
                      .span = from_stream_off(stream, -offset, 3 + offset),
-                     .constant = stream->start[stream->idx + 1]};
+                     .id = push_constant(constants,
+                                         stream->start[stream->idx + 1])};
+    }
+
+    uint32_t c32;
+    size_t len = decode_utf8(stream->start + stream->idx + 1,
+                             stream->len - stream->idx - 1, &c32);
+    if (len > 1 && stream->start[stream->idx + 1 + len] == '\'') {
+        return unicode_char(stream, char_lex, offset, len + 2, c32,
+                            constants);
     }
 
     return (Lex){.type = LEX_Invalid,
@@ -750,9 +1053,19 @@ enum lex_type get_integer_suffix(const char *input, size_t *len) {
                 return LEX_ConstantUnsignedLong;
             }
         case 'w':
+            if (input[*len + 2] == 'b') {
+                *len += 3;
+                return LEX_ConstantUnsignedBitPrecise;
+            }
+            *len += 1;
+            return LEX_ConstantUnsigned;
         case 'W':
-            *len += 2;
-            return LEX_ConstantUnsignedBitPrecise;
+            if (input[*len + 2] == 'B') {
+                *len += 3;
+                return LEX_ConstantUnsignedBitPrecise;
+            }
+            *len += 1;
+            return LEX_ConstantUnsigned;
         default:
             *len += 1;
             return LEX_ConstantUnsigned;
@@ -787,11 +1100,14 @@ enum lex_type get_integer_suffix(const char *input, size_t *len) {
         return LEX_ConstantLong;
     case 'w':
     case 'W':
-        if (input[*len + 1] == 'u' || input[*len + 1] == 'U') {
-            *len += 2;
+        // wb or WB, but not mixed case
+        if (input[*len + 1] != (input[*len] == 'w' ? 'b' : 'B')) {
+            return LEX_Constant;
+        } else if (input[*len + 2] == 'u' || input[*len + 2] == 'U') {
+            *len += 3;
             return LEX_ConstantUnsignedBitPrecise;
         }
-        *len += 1;
+        *len += 2;
         return LEX_ConstantBitPrecise;
     default:
         return LEX_Constant;
@@ -837,15 +1153,43 @@ enum lex_type get_float_suffix(const char *input, size_t *len) {
     }
 }
 
-// TODO: Faster and/or more accurate float conversion
-Lex dec_float_constant(char *input, size_t *len, size_t row, size_t col,
-                       uint64_t root) {
-    int64_t root_pow = 0;
+// Suffixed integer constant, whose digits end `len` bytes into `input`
+Lex integer_constant(char *input, size_t len, Loc loc, uint64_t constant,
+                     int overflow, Constants *constants) {
+    enum lex_type suffixed = get_integer_suffix(input, &len);
+    if (overflow) {
+        return (Lex){.type = LEX_Invalid,
+                     .span = {loc, len},
+                     .invalid = IllegalIntegerTooLarge};
+    }
+    return (Lex){.type = suffixed,
+                 .span = {loc, len},
+                 .id = push_constant(constants, constant)};
+}
+
+// Decimal exponent after e or E, or binary one after p or P.
+// Saturates, anything that large is 0 or infinity anyway.
+Lex float_exponent(char *input, size_t *len, Loc loc, int64_t *exp) {
+    *len += 1;
+    int64_t sign = 1;
+    if (input[*len] == '+') {
+        *len += 1;
+    } else if (input[*len] == '-') {
+        *len += 1;
+        sign = -1;
+    }
 
+    if (!digit(input[*len])) {
+        return (Lex){.type = LEX_Invalid,
+                     .span = {loc, *len},
+                     .invalid = IllegalFloat};
+    }
+
+    int64_t value = 0;
     while (digit(input[*len])) {
-        root *= 10;
-        root += input[*len] - '0';
-        root_pow -= 1;
+        if (value < 100000) {
+            value = value * 10 + input[*len] - '0';
+        }
 
         *len += 1;
         if (input[*len] == '\'' && digit(input[*len + 1])) {
@@ -853,121 +1197,120 @@ Lex dec_float_constant(char *input, size_t *len, size_t row, size_t col,
         }
     }
 
-    int64_t exp = 0;
-    if (input[*len] == 'e' || input[*len] == 'E') {
-        *len += 1;
-        int64_t sign = 1;
-
-        if (input[*len] == '+') {
-            *len += 1;
-        } else if (input[*len] == '-') {
-            *len += 1;
-            sign = -1;
-        }
-
-        if (!digit(input[*len])) {
-            return (Lex){.type = LEX_Invalid,
-                         .span = {input, *len, row, col},
-                         .invalid = IllegalFloat};
-        }
+    *exp = sign * value;
+    return (Lex){0};
+}
 
-        while (digit(input[*len])) {
-            exp *= 10;
-            exp += input[*len] - '0';
+// Decimal floating constant from the start of `input`
+Lex dec_float_constant(char *input, size_t *len, Loc loc,
+                       Constants *constants) {
+    // First 19 significant digits, the rest only move the exponent
+    uint64_t mantissa = 0;
+    size_t digits = 0;
+    int64_t exp10 = 0;
+    int truncated = 0, seen_dot = 0;
+    for (;;) {
+        char c = input[*len];
+        if (digit(c)) {
+            if (digits < 19 && (digits || c != '0')) {
+                mantissa = mantissa * 10 + c - '0';
+                digits += 1;
+                exp10 -= seen_dot;
+            } else if (digits) {
+                truncated |= c != '0';
+                exp10 += !seen_dot;
+            } else {
+                exp10 -= seen_dot;
+            }
 
             *len += 1;
             if (input[*len] == '\'' && digit(input[*len + 1])) {
                 *len += 1;
             }
+        } else if (c == '.' && !seen_dot) {
+            seen_dot = 1;
+            *len += 1;
+        } else {
+            break;
         }
+    }
 
-        exp *= sign;
+    size_t digits_len = *len;
+    int64_t exp = 0;
+    if (input[*len] == 'e' || input[*len] == 'E') {
+        Lex invalid = float_exponent(input, len, loc, &exp);
+        if (invalid.type || invalid.invalid) {
+            return invalid;
+        }
     }
 
     enum lex_type suffixed = get_float_suffix(input, len);
 
+    double value = decimal_to_double(mantissa, exp10 + exp, truncated, input,
+                                     digits_len, exp);
     return (Lex){.type = suffixed,
-                 .span = {input, *len, row, col},
-                 .floating = ((long double)root) * pow(10, exp + root_pow)};
+                 .span = {loc, *len},
+                 .id = push_constant(constants, to_bits(value))};
 }
 
-Lex dec_or_float_constant(char *input, size_t *len, size_t row, size_t col) {
-    uint64_t constant = input[*len] - '0';
-    *len += 1;
-
-    while (digit(input[*len])) {
-        constant *= 10;
-        constant += input[*len] - '0';
+Lex dec_or_float_constant(char *input, size_t *len, size_t limit, Loc loc,
+                          Constants *constants) {
+    int overflow = 0;
+    uint64_t constant = integer_digits(input, len, limit, 10, 0, &overflow);
 
-        *len += 1;
-        if (input[*len] == '\'' && digit(input[*len + 1])) {
-            *len += 1;
-        }
+    if (input[*len] == '.' || input[*len] == 'e' || input[*len] == 'E') {
+        *len = 0;
+        return dec_float_constant(input, len, loc, constants);
     }
 
-    if (input[*len] == '.') {
-        *len += 1;
-        return dec_float_constant(input, len, row, col, constant);
-    } else if (input[*len] == 'e' || input[*len] == 'E') {
-        return dec_float_constant(input, len, row, col, constant);
-    }
-
-    enum lex_type suffixed = get_integer_suffix(input, len);
-
-    return (Lex){.type = suffixed,
-                 .span = {input, *len, row, col},
-                 .constant = constant};
+    return integer_constant(input, *len, loc, constant, overflow, constants);
 }
 
-// TODO: This needs a proper implementation
+// Hexadecimal floating constant from the start of `input`, after its 0x
 // NOTE: Exponent is mandatory for hex but not dec
-Lex hex_float_constant(char *input, size_t *len, size_t row, size_t col,
-                       uint64_t root) {
-    int64_t root_pow = 0;
-
-    while (hex_digit(input[*len])) {
-        root *= 16;
-        root += hex_acquire(input[*len]);
-        root_pow -= 1;
+Lex hex_float_constant(char *input, size_t *len, Loc loc,
+                       Constants *constants) {
+    // First 16 significant digits, the rest only move the exponent
+    uint64_t mantissa = 0;
+    size_t digits = 0;
+    int64_t exp2 = 0;
+    int truncated = 0, seen_dot = 0;
+    for (;;) {
+        char c = input[*len];
+        if (hex_digit(c)) {
+            uint8_t value = digit_value_table[(uint8_t)c];
+            if (digits < 16 && (digits || value)) {
+                mantissa = mantissa << 4 | value;
+                digits += 1;
+                exp2 -= 4 * seen_dot;
+            } else if (digits) {
+                truncated |= value != 0;
+                exp2 += 4 * !seen_dot;
+            } else {
+                exp2 -= 4 * seen_dot;
+            }
 
-        *len += 1;
-        if (input[*len] == '\'' && hex_digit(input[*len + 1])) {
             *len += 1;
+            if (input[*len] == '\'' && hex_digit(input[*len + 1])) {
+                *len += 1;
+            }
+        } else if (c == '.' && !seen_dot) {
+            seen_dot = 1;
+            *len += 1;
+        } else {
+            break;
         }
     }
 
     int64_t exp = 0;
     if (input[*len] == 'p' || input[*len] == 'P') {
-        *len += 1;
-        int64_t sign = 1;
-
-        if (input[*len] == '+') {
-            *len += 1;
-        } else if (input[*len] == '-') {
-            *len += 1;
-            sign = -1;
+        Lex invalid = float_exponent(input, len, loc, &exp);
+        if (invalid.type || invalid.invalid) {
+            return invalid;
         }
-
-        if (!hex_digit(input[*len])) {
-            return (Lex){.type = LEX_Invalid,
-                         .span = {input, *len, row, col},
-                         .invalid = IllegalFloat};
-        }
-
-        while (hex_digit(input[*len])) {
-            exp *= 16;
-            exp += hex_acquire(input[*len]);
-
-            *len += 1;
-            if (input[*len] == '\'' && hex_digit(input[*len + 1])) {
-                *len += 1;
-            }
-        }
-
-        exp *= sign;
     } else {
         return (Lex){.type = LEX_Invalid,
-                     .span = {input, *len, row, col},
+                     .span = {loc, *len},
                      .invalid = IllegalFloatHexExponent};
     }
 
@@ -976,67 +1319,40 @@ Lex hex_float_constant(char *input, size_t *len, size_t row, size_t col,
         suffixed == LEX_ConstantDecimal64 ||
         suffixed == LEX_ConstantDecimal128) {
         return (Lex){.type = LEX_Invalid,
-                     .span = {input, *len, row, col},
+                     .span = {loc, *len},
                      .invalid = IllegalFloatHexSuffix};
     }
 
+    double value = binary_to_double(mantissa, exp2 + exp, truncated);
     return (Lex){.type = suffixed,
-                 .span = {input, *len, row, col},
-                 .floating =
-                     ((long double)root) * ((exp + root_pow >= 0)
-                                                ? 2 << (exp + root_pow * 4)
-                                                : 2 >> (exp + root_pow * 4))};
+                 .span = {loc, *len},
+                 .id = push_constant(constants, to_bits(value))};
 }
 
-Lex hex_or_float_constant(char *input, size_t *len, size_t row, size_t col) {
-    uint64_t constant = hex_acquire(input[*len]);
-    *len += 1;
-
-    while (hex_digit(input[*len])) {
-        constant *= 16;
-        constant += hex_acquire(input[*len]);
-
-        *len += 1;
-        if (input[*len] == '\'' && hex_digit(input[*len + 1])) {
-            *len += 1;
-        }
-    }
-    if (input[*len] == '.') {
-        *len += 1;
-        return dec_float_constant(input, len, row, col, constant);
-    } else if (input[*len] == 'p' || input[*len] == 'P') {
-        return dec_float_constant(input, len, row, col, constant);
+Lex hex_or_float_constant(char *input, size_t *len, size_t limit, Loc loc,
+                          Constants *constants) {
+    int overflow = 0;
+    uint64_t constant = integer_digits(input, len, limit, 16, 0, &overflow);
+    if (input[*len] == '.' || input[*len] == 'p' || input[*len] == 'P') {
+        *len = 2;
+        return hex_float_constant(input, len, loc, constants);
     }
 
-    enum lex_type suffixed = get_integer_suffix(input, len);
-
-    return (Lex){.type = suffixed,
-                 .span = {input, *len, row, col},
-                 .constant = constant};
+    return integer_constant(input, *len, loc, constant, overflow, constants);
 }
 
-Lex num_constant(const Stream *stream, char *input, size_t *len, uint64_t base,
-                 int (*xdigit)(char c), uint64_t (*xacquire)(char c)) {
-    uint64_t constant = xacquire(stream->start[stream->idx]);
-
-    while (xdigit(input[*len])) {
-        constant *= base;
-        constant += xacquire(input[*len]);
-
-        *len += 1;
-        if (input[*len] == '\'' && xdigit(input[*len + 1])) {
-            *len += 1;
-        }
-    }
-
-    enum lex_type suffixed = get_integer_suffix(input, len);
-
-    return (Lex){.type = suffixed,
-                 .span = {input, *len, stream->row, stream->col},
-                 .constant = constant};
+// Integer constant in `base`, whose digits start `len` bytes into the stream
+Lex num_constant(const Stream *stream, size_t len, uint64_t base,
+                 Constants *constants) {
+    char *input = stream->start + stream->idx;
+    int overflow = 0;
+    uint64_t constant = integer_digits(input, &len, stream->len - stream->idx,
+                                       base, 0, &overflow);
+    return integer_constant(input, len, stream->base + stream->idx, constant,
+                            overflow, constants);
 }
 
-Lex constant(Stream *stream) {
+Lex constant(Stream *stream, Constants *constants) {
     switch (stream->start[stream->idx]) {
     case '1':
     case '2':
@@ -1049,14 +1365,15 @@ Lex constant(Stream *stream) {
     case '9': {
         size_t len = 0;
         return dec_or_float_constant(stream->start + stream->idx, &len,
-                                     stream->row, stream->col);
+                                     stream->len - stream->idx,
+                                     stream->base + stream->idx, constants);
         break;
     }
     case '.':
         if (digit(stream->start[stream->idx + 1])) {
-            size_t len = 1;
+            size_t len = 0;
             return dec_float_constant(stream->start + stream->idx, &len,
-                                      stream->row, stream->col, 0);
+                                      stream->base + stream->idx, constants);
         }
         break;
     case '0':
@@ -1065,36 +1382,39 @@ Lex constant(Stream *stream) {
             if (hex_digit(stream->start[stream->idx + 2])) {
                 size_t len = 2;
                 return hex_or_float_constant(stream->start + stream->idx, &len,
-                                             stream->row, stream->col);
+                                             stream->len - stream->idx,
+                                             stream->base + stream->idx,
+                                             constants);
             } else if (stream->start[stream->idx + 2] == '.') {
                 size_t len = 2;
                 return hex_float_constant(stream->start + stream->idx, &len,
-                                          stream->row, stream->col, 0);
+                                          stream->base + stream->idx,
+                                          constants);
             }
         } else if ((stream->start[stream->idx + 1] == 'b' ||
                     stream->start[stream->idx + 1] == 'B') &&
                    bin_digit(stream->start[stream->idx + 2])) {
-            size_t len = 3;
-            Stream local = *stream;
-            local.idx += 2;
-            return num_constant(&local, stream->start + stream->idx, &len, 2,
-                                bin_digit, acquire);
-        } else if (oct_digit(stream->start[stream->idx + 1])) {
-            size_t len = 2;
-            Stream local = *stream;
-            local.idx += 1;
-            return num_constant(&local, stream->start + stream->idx, &len, 8,
-                                oct_digit, acquire);
+            return num_constant(stream, 2, 2, constants);
         } else {
+            // Leading 0 is octal, unless it turns out to be a float like 017.5
+            char *input = stream->start + stream->idx;
             size_t len = 1;
-            enum lex_type suffixed = get_integer_suffix(stream->start, &len);
-            return (Lex){.type = suffixed,
-                         .span = from_stream(stream, len),
-                         .constant = 0};
+            while (digit(input[len]) ||
+                   (input[len] == '\'' && digit(input[len + 1]))) {
+                len += 1;
+            }
+            if (input[len] == '.' || input[len] == 'e' || input[len] == 'E') {
+                len = 0;
+                return dec_or_float_constant(input, &len,
+                                             stream->len - stream->idx,
+                                             stream->base + stream->idx,
+                                             constants);
+            }
+            return num_constant(stream, 1, 8, constants);
         }
         break;
     case '\'':
-        return constant_char(stream, LEX_ConstantChar);
+        return constant_char(stream, LEX_ConstantChar, constants);
         break;
         // TODO: These need more proper handling
     case 'u':
@@ -1102,25 +1422,25 @@ Lex constant(Stream *stream) {
             stream->start[stream->idx + 2] == '\'') {
             Stream local = *stream;
             local.idx += 2;
-            return constant_char(&local, LEX_ConstantCharU8);
+            return constant_char(&local, LEX_ConstantCharU8, constants);
         } else if (stream->start[stream->idx + 1] == '\'') {
             Stream local = *stream;
             local.idx += 1;
-            return constant_char(&local, LEX_ConstantCharU16);
+            return constant_char(&local, LEX_ConstantCharU16, constants);
         }
         break;
     case 'U':
         if (stream->start[stream->idx + 1] == '\'') {
             Stream local = *stream;
             local.idx += 1;
-            return constant_char(&local, LEX_ConstantCharU32);
+            return constant_char(&local, LEX_ConstantCharU32, constants);
         }
         break;
     case 'L':
         if (stream->start[stream->idx + 1] == '\'') {
             Stream local = *stream;
             local.idx += 1;
-            return constant_char(&local, LEX_ConstantCharWide);
+            return constant_char(&local, LEX_ConstantCharWide, constants);
         }
         break;
     default:
@@ -1130,10 +1450,157 @@ Lex constant(Stream *stream) {
     return (Lex){0};
 }
 
+// Prefixes a literal can be decoded with, LEX_String up to LEX_StringWide
+#define LITERAL_TYPES (LEX_StringWide - LEX_String + 1)
+
+// Smallest block of the pool of decoded literals
+#define LITERAL_BLOCK 4096
+
+// Room for `len` bytes at the end of the pool, aligned for any code unit.
+// Returns 0 if it could not grow.
+char *reserve_pool(Literals *literals, size_t len) {
+    size_t pad = -(uintptr_t)literals->pool & 3;
+    if (literals->pool_left < len + pad) {
+        size_t size = len > LITERAL_BLOCK ? len : LITERAL_BLOCK;
+        char *block = malloc(size);
+        if (!block) {
+            return 0;
+        }
+        push_elem_vec(&literals->blocks, &block);
+        literals->pool = block;
+        literals->pool_left = size;
+        pad = 0;
+    }
+    literals->pool += pad;
+    literals->pool_left -= pad;
+    return literals->pool;
+}
+
+// Append code point `c` at `output` as code units of `size` bytes.
+// Returns the bytes written.
+size_t put_code_point(uint32_t c, size_t size, char *output) {
+    if (size == 1) {
+        return encode_utf8(c, output);
+    } else if (size == 2 && c > 0xFFFF) {
+        uint16_t pair[2] = {0xD800 + ((c - 0x10000) >> 10),
+                            0xDC00 + ((c - 0x10000) & 0x3FF)};
+        memcpy(output, pair, 4);
+        return 4;
+    } else if (size == 2) {
+        uint16_t unit = c;
+        memcpy(output, &unit, 2);
+        return 2;
+    }
+    memcpy(output, &c, 4);
+    return 4;
+}
+
+// Decode the text between the quotes of `span` into `output`, which has room
+// for a code unit of `size` bytes per byte of it. Returns the bytes written,
+// with an invalid type in `invalid` if it stopped short.
+size_t decode_units(const Span span, size_t size, char *output,
+                    enum invalid_type *invalid) {
+    const char *input = span.start + 1;
+    const char *end = span.start + span.len - 1;
+    uint32_t max = UINT32_MAX >> (32 - 8 * size);
+    size_t out = 0;
+    while (input < end) {
+        uint32_t c;
+        size_t len;
+        if (*input != '\\' && (size == 1 || (uint8_t)*input < 0x80)) {
+            // UTF-8 in the source is UTF-8 in the string
+            len = find_quote_or_escape(input, 0, end - input);
+            if (size == 1) {
+                memcpy(output + out, input, len);
+                out += len;
+            }
+            for (size_t i = 0; size > 1 && i < len; i++) {
+                if ((uint8_t)input[i] >= 0x80) {
+                    len = i;
+                    break;
+                }
+                out += put_code_point((uint8_t)input[i], size, output + out);
+            }
+        } else if (*input != '\\') {
+            len = decode_utf8(input, end - input, &c);
+            if (!len) {
+                *invalid = IllegalString;
+                return out;
+            }
+            out += put_code_point(c, size, output + out);
+        } else if (input[1] == 'u' || input[1] == 'U') {
+            len = ucn(input, &c);
+            if (!len) {
+                *invalid = IllegalEscapeChar;
+                return out;
+            }
+            out += put_code_point(c, size, output + out);
+        } else {
+            len = escape(input, &c);
+            if (!len || c > max) {
+                *invalid = IllegalEscapeChar;
+                return out;
+            }
+            // A code unit as it is, even a lone surrogate
+            if (size == 1) {
+                output[out++] = c;
+            } else {
+                out += put_code_point(c, size, output + out);
+            }
+        }
+        input += len;
+    }
+    memset(output + out, 0, size);
+    *invalid = Ok;
+    return out + size;
+}
+
+enum invalid_type decode_literal(Literals *literals, uint32_t id,
+                                 enum lex_type type, Span *units) {
+    if (type < LEX_String || type > LEX_StringWide ||
+        id >= literals->spans->length) {
+        return IllegalString;
+    }
+    size_t slot = (size_t)id * LITERAL_TYPES + (type - LEX_String);
+    while (literals->decoded->length <= slot) {
+        push_elem_vec(&literals->decoded, &(Span){0});
+    }
+    Span *decoded = at_elem_vec(literals->decoded, slot);
+    if (decoded->start) {
+        *units = *decoded;
+        return Ok;
+    }
+
+    // Never more units than bytes between the quotes, and a null one
+    Span span = *(Span *)at_elem_vec(literals->spans, id);
+    size_t size = unit_size(type);
+    char *output = reserve_pool(literals, (span.len - 1) * size);
+    if (!output) {
+        return FailedRealloc;
+    }
+    enum invalid_type invalid;
+    size_t len = decode_units(span, size, output, &invalid);
+    if (invalid) {
+        return invalid;
+    }
+
+    // Kept once, so equal strings spelled differently share their units
+    IdKey key = {word_hash((uint8_t *)output, len), output, len};
+    char **first = get_hashed_elem_dht(literals->unique, &key, id_key_eq);
+    if (first) {
+        *decoded = (Span){*first, len};
+    } else {
+        put_hashed_elem_dht(&literals->unique, &key, &output, id_key_eq);
+        literals->pool += len;
+        literals->pool_left -= len;
+        *decoded = (Span){output, len};
+    }
+    *units = *decoded;
+    return Ok;
+}
+
 Lex string_ret(const Stream *stream, size_t limit, enum lex_type str_lex,
-               Vector **id_table) {
-    const char *input = stream->start + stream->idx;
-    size_t len = 1;
+               Literals *literals) {
     size_t offset;
     switch (str_lex) {
     case LEX_StringU8:
@@ -1149,52 +1616,52 @@ Lex string_ret(const Stream *stream, size_t limit, enum lex_type str_lex,
         break;
     default:
         return (Lex){.type = LEX_Invalid,
-                     .span = from_stream(stream, len),
+                     .span = from_stream(stream, 1),
                      .invalid = IllegalString};
     }
 
-    while (input[len] != '"') {
-        if (input[len] == '\\' && input[len + 1] == '"') {
-            len += 2;
-        } else {
-            len += 1;
-        }
+    // Escapes are skipped whole, so \\" still ends the string
+    size_t end = stream->idx + limit;
+    size_t idx = find_quote_or_escape(stream->start, stream->idx + 1, end);
+    while (idx < end && stream->start[idx] == '\\') {
+        idx = find_quote_or_escape(stream->start, idx + 2, end);
+    }
 
-        if (limit <= len) {
-            return (Lex){.type = LEX_Invalid,
-                         .span = from_stream_off(stream, -offset, len + offset),
-                         .invalid = IllegalString};
-        }
+    if (idx >= end) {
+        return (Lex){.type = LEX_Invalid,
+                     .span = from_stream_off(stream, -offset, limit + offset),
+                     .invalid = IllegalString};
     }
 
-    len += 1;
+    size_t len = idx + 1 - stream->idx;
 
     return (Lex){.type = str_lex,
                  .span = from_stream_off(stream, -offset, len + offset),
-                 .id = search_id_table(from_stream(stream, len), id_table)};
+                 .id = search_literals(
+                     (Span){stream->start + stream->idx, len}, literals)};
 }
 
-Lex string(const Stream *stream, size_t limit, Vector **id_table) {
+Lex string(const Stream *stream, size_t limit, Literals *literals) {
     Stream local = *stream;
     if (local.start[local.idx] == '"') {
-        return string_ret(&local, limit, LEX_String, id_table);
+        return string_ret(&local, limit, LEX_String, literals);
     } else if (local.start[local.idx] == 'u') {
         if (local.start[local.idx + 1] == '8' &&
             local.start[local.idx + 2] == '"') {
             local.idx += 2;
-            return string_ret(&local, limit - 2, LEX_StringU8, id_table);
+            return string_ret(&local, limit - 2, LEX_StringU8, literals);
         } else if (local.start[local.idx + 1] == '"') {
             local.idx += 1;
-            return string_ret(&local, limit - 1, LEX_StringU16, id_table);
+            return string_ret(&local, limit - 1, LEX_StringU16, literals);
         }
     } else if (local.start[local.idx] == 'U' &&
                local.start[local.idx + 1] == '"') {
         local.idx += 1;
-        return string_ret(&local, limit - 1, LEX_StringU32, id_table);
+        return string_ret(&local, limit - 1, LEX_StringU32, literals);
     } else if (local.start[local.idx] == 'L' &&
                local.start[local.idx + 1] == '"') {
         local.idx += 1;
-        return string_ret(&local, limit - 1, LEX_StringWide, id_table);
+        return string_ret(&local, limit - 1, LEX_StringWide, literals);
     }
 
     return (Lex){0};
@@ -1203,763 +1670,859 @@ Lex string(const Stream *stream, size_t limit, Vector **id_table) {
 Lex comment(Stream *stream, size_t limit) {
     if (stream->start[stream->idx] == '/') {
         if (stream->start[stream->idx + 1] == '/') {
-            const char *input = stream->start + stream->idx;
-            size_t len = 2;
-            while (input[len] != '\n') {
-                len += 1;
-                if (limit <= len) {
-                    return (Lex){.type = LEX_Eof};
-                }
+            size_t end = find_newline(stream->start, stream->idx + 2,
+                                      stream->idx + limit);
+            if (end >= stream->idx + limit) {
+                return (Lex){.type = LEX_Eof};
             }
-            stream->row += 1;
-            stream->col = 0;
-            return (Lex){.type = LEX_Comment, .span = from_stream(stream, len)};
+            return (Lex){.type = LEX_Comment,
+                         .span = from_stream(stream, end - stream->idx)};
         } else if (stream->start[stream->idx + 1] == '*') {
-            const char *input = stream->start + stream->idx;
-            size_t len = 2;
-            while (input[len] != '*' || input[len + 1] != '/') {
-                if (input[len] == '\n') {
-                    stream->row += 1;
-                    stream->col = 0;
-                }
-                len += 1;
-                if (limit <= len + 1) {
-                    return (Lex){.type = LEX_Eof};
-                }
+            size_t end = skip_block_comment(stream->start, stream->idx + 2,
+                                            stream->idx + limit);
+            if (end >= stream->idx + limit) {
+                return (Lex){.type = LEX_Eof};
             }
-
-            len += 2;
-
-            return (Lex){.type = LEX_Comment, .span = from_stream(stream, len)};
+            return (Lex){.type = LEX_Comment,
+                         .span = from_stream(stream, end - stream->idx)};
         }
     }
 
     return (Lex){0};
 }
 
-Lex lex_next(Stream *stream, Ids **id_table) {
-    while (stream->idx < stream->len) {
-        Lex key = keyword_or_id(stream, id_table);
-        if (key.type || key.invalid) {
-            stream->idx += key.span.len;
-            stream->col += key.span.len;
-            return key;
-        }
-
-        Lex cnst = constant(stream);
-        if (cnst.type || cnst.invalid) {
-            stream->idx += cnst.span.len;
-            stream->col += cnst.span.len;
-            return cnst;
-        }
+// Skips whitespace, and newlines as well if not inside a directive
+void space(Stream *stream) {
+    stream->idx = skip_space(stream->start, stream->idx, stream->len,
+                             !stream->macro_line);
+}
 
-        Lex str = string(stream, stream->len - stream->idx, id_table);
-        if (str.type || str.invalid) {
-            stream->idx += str.span.len;
-            stream->col += str.span.len;
-            return str;
-        }
+// Quote if u, u8, U or L start a char or string literal instead of an id
+char literal_prefix(const Stream *stream) {
+    const char *input = stream->start + stream->idx;
+    if (input[0] == 'u' && input[1] == '8') {
+        input += 1;
+    }
+    return (input[1] == '\'' || input[1] == '"') ? input[1] : 0;
+}
 
-        Lex comm = comment(stream, stream->len - stream->idx);
-        if (comm.type) {
-            if (comm.type == LEX_Eof) {
-                return comm;
-            } else {
-                stream->idx += comm.span.len;
-                continue;
+Lex lex_next(Stream *stream, Ids *id_table, Literals *literals,
+             Constants *constants) {
+    while (stream->idx < stream->len) {
+        Lex lex;
+        switch (char_class_table[(uint8_t)stream->start[stream->idx]]) {
+        case CC_Space:
+            stream->idx += 1;
+            if (char_class_table[(uint8_t)stream->start[stream->idx]] <=
+                CC_Newline) {
+                space(stream);
             }
-        }
-
-        Lex punct = punctuator(stream, id_table);
-        if (punct.type || punct.invalid) {
-            stream->idx += punct.span.len;
-            stream->col += punct.span.len;
-            return punct;
-        }
-
-        if (stream->macro_line && stream->start[stream->idx] == '\\' &&
-            stream->start[stream->idx + 1] == '\n') {
-            stream->idx += 2;
-            stream->row += 1;
-            stream->col = 0;
-        } else if (stream->start[stream->idx] == '\n') {
+            continue;
+        case CC_Newline:
             if (stream->macro_line) {
                 stream->macro_line = 0;
+                STAT_ADD(tokens[LEX_MacroEndToken], 1);
                 return (Lex){
                     .type = LEX_MacroEndToken,
                     .span = from_stream_off(stream, -1, 1),
                 };
             }
             stream->idx += 1;
-            stream->row += 1;
-            stream->col = 0;
-        } else {
-            if (!space(stream->start[stream->idx])) {
-                stream->idx += 1;
-                stream->col += 1;
-                return (Lex){.type = LEX_Invalid,
-                             .span = from_stream_off(stream, -1, 1),
-                             .invalid = IllegalToken};
+            if (char_class_table[(uint8_t)stream->start[stream->idx]] <=
+                CC_Newline) {
+                space(stream);
             }
-            stream->idx += 1;
-            stream->col += 1;
+            continue;
+        case CC_Backslash:
+            if (stream->macro_line && stream->start[stream->idx + 1] == '\n') {
+                stream->idx += 2;
+                continue;
+            }
+            lex = extended_id(stream, id_table, 0);
+            break;
+        case CC_Prefix:
+            switch (literal_prefix(stream)) {
+            case '\'':
+                lex = constant(stream, constants);
+                break;
+            case '"':
+                lex = string(stream, stream->len - stream->idx, literals);
+                break;
+            default:
+                lex = keyword_or_id(stream, id_table);
+                break;
+            }
+            break;
+        case CC_Nondigit:
+            lex = keyword_or_id(stream, id_table);
+            break;
+        case CC_Utf8:
+            lex = extended_id(stream, id_table, 0);
+            break;
+        case CC_Digit:
+        case CC_Quote:
+            lex = constant(stream, constants);
+            break;
+        case CC_Dot:
+            lex = constant(stream, constants);
+            if (!lex.type && !lex.invalid) {
+                lex = punctuator(stream, id_table);
+            }
+            break;
+        case CC_DoubleQuote:
+            lex = string(stream, stream->len - stream->idx, literals);
+            break;
+        case CC_Slash:
+            lex = comment(stream, stream->len - stream->idx);
+            if (lex.type == LEX_Eof) {
+                return lex;
+            } else if (lex.type) {
+                stream->idx += lex.span.len;
+                continue;
+            }
+            lex = punctuator(stream, id_table);
+            break;
+        case CC_Punct:
+            lex = punctuator(stream, id_table);
+            break;
+        default:
+            goto Illegal;
+        }
+
+        if (lex.type || lex.invalid) {
+            stream->idx += lex.span.len;
+            STAT_ADD(tokens[lex.type], 1);
+            return lex;
         }
+
+    Illegal:
+        stream->idx += 1;
+        STAT_ADD(tokens[LEX_Invalid], 1);
+        return (Lex){.type = LEX_Invalid,
+                     .span = from_stream_off(stream, -1, 1),
+                     .invalid = IllegalToken};
     }
 
     return (Lex){.type = LEX_Eof};
 }
 
-Span from_stream(const Stream *stream, size_t len) {
-    return (Span){.start = (char *)stream->start + stream->idx,
-                  .len = len,
-                  .row = stream->row,
-                  .col = stream->col};
+Range from_stream(const Stream *stream, size_t len) {
+    return (Range){.loc = stream->base + stream->idx, .len = len};
 }
 
-Span from_stream_off(const Stream *stream, ptrdiff_t off, size_t len) {
-    return (Span){.start = (char *)stream->start + stream->idx + off,
-                  .len = len,
-                  .row = stream->row,
-                  .col = stream->col};
+Range from_stream_off(const Stream *stream, ptrdiff_t off, size_t len) {
+    return (Range){.loc = stream->base + stream->idx + off, .len = len};
 }
 
-Ids *create_ids(size_t capacity) { return create_vec(capacity, sizeof(Span)); }
+Ids *create_ids(size_t capacity) {
+    Ids *id_table = malloc(sizeof(*id_table));
+    id_table->spans = create_vec(capacity, sizeof(Span));
+    id_table->hashes = create_vec(capacity, sizeof(uint64_t));
+    id_table->decoded = create_vec(0, sizeof(char *));
+    id_table->index = create_dht(capacity, sizeof(IdKey), sizeof(size_t));
+    return id_table;
+}
+
+void delete_ids(Ids *id_table) {
+    delete_vec(id_table->spans);
+    delete_vec(id_table->hashes);
+    for (size_t i = 0; i < id_table->decoded->length; i++) {
+        free(*(char **)at_elem_vec(id_table->decoded, i));
+    }
+    delete_vec(id_table->decoded);
+    delete_dht(id_table->index);
+    free(id_table);
+}
+
+Literals *create_literals(size_t capacity) {
+    Literals *literals = malloc(sizeof(*literals));
+    literals->spans = create_vec(capacity, sizeof(Span));
+    literals->index = create_dht(capacity, sizeof(IdKey), sizeof(size_t));
+    literals->decoded = create_vec(0, sizeof(Span));
+    literals->blocks = create_vec(0, sizeof(char *));
+    literals->pool = 0;
+    literals->pool_left = 0;
+    literals->unique = create_dht(8, sizeof(IdKey), sizeof(char *));
+    return literals;
+}
+
+void delete_literals(Literals *literals) {
+    delete_vec(literals->spans);
+    delete_dht(literals->index);
+    delete_vec(literals->decoded);
+    for (size_t i = 0; i < literals->blocks->length; i++) {
+        free(*(char **)at_elem_vec(literals->blocks, i));
+    }
+    delete_vec(literals->blocks);
+    delete_dht(literals->unique);
+    free(literals);
+}
+
+Constants *create_constants(size_t capacity) {
+    Constants *constants = malloc(sizeof(*constants));
+    constants->bits = create_vec(capacity, sizeof(uint64_t));
+    return constants;
+}
+
+void delete_constants(Constants *constants) {
+    delete_vec(constants->bits);
+    free(constants);
+}
+
+uint32_t push_constant(Constants *constants, uint64_t bits) {
+    push_elem_vec(&constants->bits, &bits);
+    return constants->bits->length - 1;
+}
+
+uint64_t get_constant(const Constants *constants, uint32_t id) {
+    return *(uint64_t *)at_elem_vec(constants->bits, id);
+}
 
 Lexes *create_lexes(size_t capacity) {
     return create_vec(capacity, sizeof(Lex));
 }
 
+Tokens *create_tokens(size_t capacity) {
+    Tokens *tokens = malloc(sizeof(*tokens));
+    *tokens = (Tokens){.capacity = capacity,
+                       .kind = malloc(capacity * sizeof(uint8_t)),
+                       .offset = malloc(capacity * sizeof(uint32_t)),
+                       .len = malloc(capacity * sizeof(uint32_t)),
+                       .payload = malloc(capacity * sizeof(uint32_t))};
+    return tokens;
+}
+
+void reset_tokens(Tokens *tokens) { tokens->length = 0; }
+
+void delete_tokens(Tokens *tokens) {
+    free(tokens->kind);
+    free(tokens->offset);
+    free(tokens->len);
+    free(tokens->payload);
+    free(tokens);
+}
+
+// Grows with *3/2 like the vectors, ups to 4 beforehand if less than 4
+int grow_tokens(Tokens *tokens) {
+    size_t capacity = tokens->capacity < 4 ? 4 : tokens->capacity * 3 / 2;
+    uint8_t *kind = realloc(tokens->kind, capacity * sizeof(uint8_t));
+    if (!kind) {
+        return 0;
+    }
+    tokens->kind = kind;
+
+    uint32_t **fields[] = {&tokens->offset, &tokens->len, &tokens->payload};
+    for (size_t i = 0; i < sizeof(fields) / sizeof(*fields); i++) {
+        uint32_t *field = realloc(*fields[i], capacity * sizeof(uint32_t));
+        if (!field) {
+            return 0;
+        }
+        *fields[i] = field;
+    }
+
+    tokens->capacity = capacity;
+    return 1;
+}
+
+int push_token(Tokens *tokens, const Stream *stream, Lex lex) {
+    if (tokens->length >= tokens->capacity && !grow_tokens(tokens)) {
+        return 0;
+    }
+
+    size_t i = tokens->length++;
+    tokens->kind[i] = lex.type;
+    tokens->offset[i] =
+        lex.type == LEX_Eof ? stream->len : lex.span.loc - stream->base;
+    tokens->len[i] = lex.span.len;
+    tokens->payload[i] = lex.id;
+    return 1;
+}
+
+int lex_file(Stream *stream, Ids *id_table, Literals *literals,
+             Constants *constants, Tokens *tokens) {
+    reset_tokens(tokens);
+    for (;;) {
+        Lex lex = lex_next(stream, id_table, literals, constants);
+        if (!push_token(tokens, stream, lex)) {
+            return 0;
+        } else if (lex.type == LEX_Eof) {
+            return 1;
+        }
+    }
+}
+
+Range token_range(const Tokens *tokens, const Stream *stream, size_t idx) {
+    return (Range){stream->base + tokens->offset[idx], tokens->len[idx]};
+}
+
 void print_ids(const Ids *ids) {
-    for (uint64_t i = 0; i < ids->length; i++) {
-        Span span = *(Span *)at_elem_vec((Ids *)ids, i);
+    for (uint64_t i = 0; i < ids->spans->length; i++) {
+        Span span = *(Span *)at_elem_vec(ids->spans, i);
         printf("<Id %zu %.*s>\n", i, (int)span.len, span.start);
     }
 }
 
-void print_lexes(const Lexes *lexes, int depth) {
+void print_literals(const Literals *literals) {
+    for (uint64_t i = 0; i < literals->spans->length; i++) {
+        Span span = *(Span *)at_elem_vec(literals->spans, i);
+        printf("<Literal %zu %.*s>\n", i, (int)span.len, span.start);
+    }
+}
+
+void print_lexes(const Lexes *lexes, const Constants *constants,
+                 Locations *locations, int depth) {
     for (uint64_t i = 0; i < lexes->length; i++) {
         Lex lex = *(Lex *)at_elem_vec((Lexes *)lexes, i);
+        Position pos = resolve_loc(locations, lex.span.loc);
+        // Without a table, constants print their id instead
+        uint64_t constant = lex.id;
+        double floating = lex.id;
+        if (constants && lex.type >= LEX_ConstantUnsignedLongLong &&
+            lex.type <= LEX_ConstantCharWide) {
+            constant = get_constant(constants, lex.id);
+            memcpy(&floating, &constant, sizeof(floating));
+        }
         switch (lex.type) {
         case LEX_Invalid:
             if (lex.invalid) {
-                printf("%*c:Lex Error %d: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.invalid, lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Lex Error %d: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.invalid, lex.span.len, pos.file, pos.row, pos.col);
             } else {
-                printf("%*c:Lex Ok: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Lex Ok: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
             }
             break;
         case LEX_Eof:
-            printf("%*c:End of File: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:End of File: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_StringU8:
-            printf("%*c:StringU8 id %zu: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.id, lex.span.start, lex.span.len, lex.span.row,
-                   lex.span.col);
+            printf("%*c:StringU8 id %u: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.id, lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_StringU16:
-            printf("%*c:StringU16 id %zu: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.id, lex.span.start, lex.span.len, lex.span.row,
-                   lex.span.col);
+            printf("%*c:StringU16 id %u: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.id, lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_StringU32:
-            printf("%*c:StringU32 id %zu: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.id, lex.span.start, lex.span.len, lex.span.row,
-                   lex.span.col);
+            printf("%*c:StringU32 id %u: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.id, lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_StringWide:
-            printf("%*c:StringWide id %zu: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.id, lex.span.start, lex.span.len, lex.span.row,
-                   lex.span.col);
+            printf("%*c:StringWide id %u: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.id, lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_String:
-            printf("%*c:String id %zu: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.id, lex.span.start, lex.span.len, lex.span.row,
-                   lex.span.col);
+            printf("%*c:String id %u: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.id, lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_Identifier:
-            printf("%*c:Identifier id %zu: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.id, lex.span.start, lex.span.len, lex.span.row,
-                   lex.span.col);
+            printf("%*c:Identifier id %u: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.id, lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_ConstantUnsignedLongLong:
-            printf("%*c:UnsignedLongLongNumber %zu: [%p, %zu, %zu, %zu]\n",
-                   depth, ' ', lex.constant, lex.span.start, lex.span.len,
-                   lex.span.row, lex.span.col);
+            printf("%*c:UnsignedLongLongNumber %zu: [%u, %zu, %zu, %zu]\n",
+                   depth, ' ', constant, lex.span.len, pos.file, pos.row,
+                   pos.col);
             break;
         case LEX_ConstantUnsignedLong:
-            printf("%*c:UnsignedLongNumber %zu: [%p, %zu, %zu, %zu]\n", depth,
-                   ' ', lex.constant, lex.span.start, lex.span.len,
-                   lex.span.row, lex.span.col);
+            printf("%*c:UnsignedLongNumber %zu: [%u, %zu, %zu, %zu]\n", depth,
+                   ' ', constant, lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_ConstantUnsignedBitPrecise:
-            printf("%*c:UnsignedBitPreciseNumber %zu: [%p, %zu, %zu, %zu]\n",
-                   depth, ' ', lex.constant, lex.span.start, lex.span.len,
-                   lex.span.row, lex.span.col);
+            printf("%*c:UnsignedBitPreciseNumber %zu: [%u, %zu, %zu, %zu]\n",
+                   depth, ' ', constant, lex.span.len, pos.file, pos.row,
+                   pos.col);
             break;
         case LEX_ConstantUnsigned:
-            printf("%*c:UnsignedNumber %zu: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.constant, lex.span.start, lex.span.len, lex.span.row,
-                   lex.span.col);
+            printf("%*c:UnsignedNumber %zu: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   constant, lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_ConstantLongLong:
-            printf("%*c:LongLongNumber %zu: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.constant, lex.span.start, lex.span.len, lex.span.row,
-                   lex.span.col);
+            printf("%*c:LongLongNumber %zu: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   constant, lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_ConstantLong:
-            printf("%*c:LongNumber %zu: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.constant, lex.span.start, lex.span.len, lex.span.row,
-                   lex.span.col);
+            printf("%*c:LongNumber %zu: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   constant, lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_ConstantBitPrecise:
-            printf("%*c:BitPreciseNumber %zu: [%p, %zu, %zu, %zu]\n", depth,
-                   ' ', lex.constant, lex.span.start, lex.span.len,
-                   lex.span.row, lex.span.col);
+            printf("%*c:BitPreciseNumber %zu: [%u, %zu, %zu, %zu]\n", depth,
+                   ' ', constant, lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_Constant:
-            printf("%*c:Number %zu: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.constant, lex.span.start, lex.span.len, lex.span.row,
-                   lex.span.col);
+            printf("%*c:Number %zu: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   constant, lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_ConstantFloat:
-            printf("%*c:Float %f: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.floating, lex.span.start, lex.span.len, lex.span.row,
-                   lex.span.col);
+            printf("%*c:Float %f: [%u, %zu, %zu, %zu]\n", depth, ' ', floating,
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_ConstantDouble:
-            printf("%*c:Double %f: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.floating, lex.span.start, lex.span.len, lex.span.row,
-                   lex.span.col);
+            printf("%*c:Double %f: [%u, %zu, %zu, %zu]\n", depth, ' ', floating,
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_ConstantLongDouble:
-            printf("%*c:LongDouble %f: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.floating, lex.span.start, lex.span.len, lex.span.row,
-                   lex.span.col);
+            printf("%*c:LongDouble %f: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   floating, lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_ConstantDecimal32:
-            printf("%*c:Dec32 %f: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.floating, lex.span.start, lex.span.len, lex.span.row,
-                   lex.span.col);
+            printf("%*c:Dec32 %f: [%u, %zu, %zu, %zu]\n", depth, ' ', floating,
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_ConstantDecimal64:
-            printf("%*c:Dec64 %f: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.floating, lex.span.start, lex.span.len, lex.span.row,
-                   lex.span.col);
+            printf("%*c:Dec64 %f: [%u, %zu, %zu, %zu]\n", depth, ' ', floating,
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_ConstantDecimal128:
-            printf("%*c:Dec128 %f: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.floating, lex.span.start, lex.span.len, lex.span.row,
-                   lex.span.col);
+            printf("%*c:Dec128 %f: [%u, %zu, %zu, %zu]\n", depth, ' ', floating,
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_ConstantCharU8:
-            printf("%*c:CharU8 %zu: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.constant, lex.span.start, lex.span.len, lex.span.row,
-                   lex.span.col);
+            printf("%*c:CharU8 %zu: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   constant, lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_ConstantCharU16:
-            printf("%*c:CharU16 %zu: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.constant, lex.span.start, lex.span.len, lex.span.row,
-                   lex.span.col);
+            printf("%*c:CharU16 %zu: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   constant, lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_ConstantCharU32:
-            printf("%*c:CharU32 %zu: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.constant, lex.span.start, lex.span.len, lex.span.row,
-                   lex.span.col);
+            printf("%*c:CharU32 %zu: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   constant, lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_ConstantCharWide:
-            printf("%*c:CharWide %zu: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.constant, lex.span.start, lex.span.len, lex.span.row,
-                   lex.span.col);
+            printf("%*c:CharWide %zu: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   constant, lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_ConstantChar:
-            printf("%*c:Char %zu: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.constant, lex.span.start, lex.span.len, lex.span.row,
-                   lex.span.col);
+            printf("%*c:Char %zu: [%u, %zu, %zu, %zu]\n", depth, ' ', constant,
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_Keyword:
             switch (lex.key) {
             case KEY_alignas:
-                printf("%*c:Keyword alignas: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword alignas: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_alignof:
-                printf("%*c:Keyword alignof: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword alignof: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_auto:
-                printf("%*c:Keyword auto: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword auto: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_bool:
-                printf("%*c:Keyword bool: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword bool: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_break:
-                printf("%*c:Keyword break: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword break: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_case:
-                printf("%*c:Keyword case: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword case: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_char:
-                printf("%*c:Keyword char: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword char: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_const:
-                printf("%*c:Keyword const: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword const: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_constexpr:
-                printf("%*c:Keyword constexpr: [%p, %zu, %zu, %zu]\n", depth,
-                       ' ', lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword constexpr: [%u, %zu, %zu, %zu]\n", depth,
+                       ' ', lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_continue:
-                printf("%*c:Keyword continue: [%p, %zu, %zu, %zu]\n", depth,
-                       ' ', lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword continue: [%u, %zu, %zu, %zu]\n", depth,
+                       ' ', lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_default:
-                printf("%*c:Keyword default: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword default: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_do:
-                printf("%*c:Keyword do: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword do: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_double:
-                printf("%*c:Keyword double: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword double: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_else:
-                printf("%*c:Keyword else: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword else: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_enum:
-                printf("%*c:Keyword enum: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword enum: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_extern:
-                printf("%*c:Keyword extern: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword extern: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_false:
-                printf("%*c:Keyword false: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword false: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_float:
-                printf("%*c:Keyword float: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword float: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_for:
-                printf("%*c:Keyword for: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword for: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_goto:
-                printf("%*c:Keyword goto: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword goto: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_if:
-                printf("%*c:Keyword if: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword if: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_inline:
-                printf("%*c:Keyword inline: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword inline: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_int:
-                printf("%*c:Keyword int: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword int: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_long:
-                printf("%*c:Keyword long: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword long: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_nullptr:
-                printf("%*c:Keyword nullptr: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword nullptr: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_register:
-                printf("%*c:Keyword register: [%p, %zu, %zu, %zu]\n", depth,
-                       ' ', lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword register: [%u, %zu, %zu, %zu]\n", depth,
+                       ' ', lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_restrict:
-                printf("%*c:Keyword restrict: [%p, %zu, %zu, %zu]\n", depth,
-                       ' ', lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword restrict: [%u, %zu, %zu, %zu]\n", depth,
+                       ' ', lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_return:
-                printf("%*c:Keyword return: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword return: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_short:
-                printf("%*c:Keyword short: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword short: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_signed:
-                printf("%*c:Keyword signed: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword signed: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_sizeof:
-                printf("%*c:Keyword sizeof: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword sizeof: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_static:
-                printf("%*c:Keyword static: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword static: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_static_assert:
-                printf("%*c:Keyword static: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword static: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_struct:
-                printf("%*c:Keyword struct: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword struct: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_switch:
-                printf("%*c:Keyword switch: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword switch: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_thread_local:
-                printf("%*c:Keyword thread: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword thread: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_true:
-                printf("%*c:Keyword true: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword true: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_typedef:
-                printf("%*c:Keyword typedef: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword typedef: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_typeof:
-                printf("%*c:Keyword typeof: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword typeof: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_typeof_unqual:
-                printf("%*c:Keyword typeof: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword typeof: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_union:
-                printf("%*c:Keyword union: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword union: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_unsigned:
-                printf("%*c:Keyword unsigned: [%p, %zu, %zu, %zu]\n", depth,
-                       ' ', lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword unsigned: [%u, %zu, %zu, %zu]\n", depth,
+                       ' ', lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_void:
-                printf("%*c:Keyword void: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword void: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_volatile:
-                printf("%*c:Keyword volatile: [%p, %zu, %zu, %zu]\n", depth,
-                       ' ', lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword volatile: [%u, %zu, %zu, %zu]\n", depth,
+                       ' ', lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_while:
-                printf("%*c:Keyword while: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword while: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY__Atomic:
-                printf("%*c:Keyword _Atomic: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword _Atomic: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY__BitInt:
-                printf("%*c:Keyword _BitInt: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                       lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword _BitInt: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                       lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY__Complex:
-                printf("%*c:Keyword _Complex: [%p, %zu, %zu, %zu]\n", depth,
-                       ' ', lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword _Complex: [%u, %zu, %zu, %zu]\n", depth,
+                       ' ', lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY__Decimal128:
-                printf("%*c:Keyword _Decimal128: [%p, %zu, %zu, %zu]\n", depth,
-                       ' ', lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword _Decimal128: [%u, %zu, %zu, %zu]\n", depth,
+                       ' ', lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY__Decimal32:
-                printf("%*c:Keyword _Decimal32: [%p, %zu, %zu, %zu]\n", depth,
-                       ' ', lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword _Decimal32: [%u, %zu, %zu, %zu]\n", depth,
+                       ' ', lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY__Decimal64:
-                printf("%*c:Keyword _Decimal64: [%p, %zu, %zu, %zu]\n", depth,
-                       ' ', lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword _Decimal64: [%u, %zu, %zu, %zu]\n", depth,
+                       ' ', lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY__Generic:
-                printf("%*c:Keyword _Generic: [%p, %zu, %zu, %zu]\n", depth,
-                       ' ', lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword _Generic: [%u, %zu, %zu, %zu]\n", depth,
+                       ' ', lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY__Imaginary:
-                printf("%*c:Keyword _Imaginary: [%p, %zu, %zu, %zu]\n", depth,
-                       ' ', lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword _Imaginary: [%u, %zu, %zu, %zu]\n", depth,
+                       ' ', lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY__Noreturn:
-                printf("%*c:Keyword _Noreturn: [%p, %zu, %zu, %zu]\n", depth,
-                       ' ', lex.span.start, lex.span.len, lex.span.row,
-                       lex.span.col);
+                printf("%*c:Keyword _Noreturn: [%u, %zu, %zu, %zu]\n", depth,
+                       ' ', lex.span.len, pos.file, pos.row, pos.col);
                 break;
             case KEY_COUNT:
                 break;
             }
             break;
         case LEX_MacroToken:
-            printf("%*c:MacroToken: %d [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.macro, lex.span.start, lex.span.len, lex.span.row,
-                   lex.span.col);
+            printf("%*c:MacroToken: %d [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.macro, lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_MacroEndToken:
-            printf("%*c:MacroEndToken: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:MacroEndToken: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_LBracket:
-            printf("%*c:LBracket: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:LBracket: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_RBracket:
-            printf("%*c:RBracket: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:RBracket: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_LParen:
-            printf("%*c:LParen: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:LParen: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_RParen:
-            printf("%*c:RParen: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:RParen: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_LSquigly:
-            printf("%*c:LSquigly: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:LSquigly: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_RSquigly:
-            printf("%*c:RSquigly: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:RSquigly: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_Dot:
-            printf("%*c:Dot: [%p, %zu, %zu, %zu]\n", depth, ' ', lex.span.start,
-                   lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:Dot: [%u, %zu, %zu, %zu]\n", depth, ' ', lex.span.len,
+                   pos.file, pos.row, pos.col);
             break;
         case LEX_Arrow:
-            printf("%*c:Arrow: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:Arrow: [%u, %zu, %zu, %zu]\n", depth, ' ', lex.span.len,
+                   pos.file, pos.row, pos.col);
             break;
         case LEX_PlusPlus:
-            printf("%*c:PlusPlus: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:PlusPlus: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_MinusMinus:
-            printf("%*c:MinusMinus: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:MinusMinus: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_Et:
-            printf("%*c:Et: [%p, %zu, %zu, %zu]\n", depth, ' ', lex.span.start,
-                   lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:Et: [%u, %zu, %zu, %zu]\n", depth, ' ', lex.span.len,
+                   pos.file, pos.row, pos.col);
             break;
         case LEX_Star:
-            printf("%*c:Star: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:Star: [%u, %zu, %zu, %zu]\n", depth, ' ', lex.span.len,
+                   pos.file, pos.row, pos.col);
             break;
         case LEX_Plus:
-            printf("%*c:Plus: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:Plus: [%u, %zu, %zu, %zu]\n", depth, ' ', lex.span.len,
+                   pos.file, pos.row, pos.col);
             break;
         case LEX_Minus:
-            printf("%*c:Minus: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:Minus: [%u, %zu, %zu, %zu]\n", depth, ' ', lex.span.len,
+                   pos.file, pos.row, pos.col);
             break;
         case LEX_Tilde:
-            printf("%*c:Tilde: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:Tilde: [%u, %zu, %zu, %zu]\n", depth, ' ', lex.span.len,
+                   pos.file, pos.row, pos.col);
             break;
         case LEX_Exclamation:
-            printf("%*c:Exclamation: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:Exclamation: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_Slash:
-            printf("%*c:Slash: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:Slash: [%u, %zu, %zu, %zu]\n", depth, ' ', lex.span.len,
+                   pos.file, pos.row, pos.col);
             break;
         case LEX_Percent:
-            printf("%*c:Percent: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:Percent: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_LeftLeft:
-            printf("%*c:LeftLeft: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:LeftLeft: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_RightRight:
-            printf("%*c:RightRight: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:RightRight: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_Left:
-            printf("%*c:Left: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:Left: [%u, %zu, %zu, %zu]\n", depth, ' ', lex.span.len,
+                   pos.file, pos.row, pos.col);
             break;
         case LEX_Right:
-            printf("%*c:Right: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:Right: [%u, %zu, %zu, %zu]\n", depth, ' ', lex.span.len,
+                   pos.file, pos.row, pos.col);
             break;
         case LEX_LeftEqual:
-            printf("%*c:LeftEqual: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:LeftEqual: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_RightEqual:
-            printf("%*c:RightEqual: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:RightEqual: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_EqualEqual:
-            printf("%*c:EqualEqual: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:EqualEqual: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_ExclamationEqual:
-            printf("%*c:ExclamationEqual: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:ExclamationEqual: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_Caret:
-            printf("%*c:Caret: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:Caret: [%u, %zu, %zu, %zu]\n", depth, ' ', lex.span.len,
+                   pos.file, pos.row, pos.col);
             break;
         case LEX_Pipe:
-            printf("%*c:Pipe: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:Pipe: [%u, %zu, %zu, %zu]\n", depth, ' ', lex.span.len,
+                   pos.file, pos.row, pos.col);
             break;
         case LEX_EtEt:
-            printf("%*c:EtEt: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:EtEt: [%u, %zu, %zu, %zu]\n", depth, ' ', lex.span.len,
+                   pos.file, pos.row, pos.col);
             break;
         case LEX_PipePipe:
-            printf("%*c:PipePipe: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:PipePipe: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_Question:
-            printf("%*c:Question: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:Question: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_Colon:
-            printf("%*c:Colon: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:Colon: [%u, %zu, %zu, %zu]\n", depth, ' ', lex.span.len,
+                   pos.file, pos.row, pos.col);
             break;
         case LEX_ColonColon:
-            printf("%*c:ColonColon: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:ColonColon: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_Semicolon:
-            printf("%*c:Semicolon: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:Semicolon: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_DotDotDot:
-            printf("%*c:DotDotDot: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:DotDotDot: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_Equal:
-            printf("%*c:Equal: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:Equal: [%u, %zu, %zu, %zu]\n", depth, ' ', lex.span.len,
+                   pos.file, pos.row, pos.col);
             break;
         case LEX_StarEqual:
-            printf("%*c:StarEqual: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:StarEqual: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_SlashEqual:
-            printf("%*c:SlashEqual: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:SlashEqual: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_PercentEqual:
-            printf("%*c:PercentEqual: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:PercentEqual: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_PlusEqual:
-            printf("%*c:PlusEqual: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:PlusEqual: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_MinusEqual:
-            printf("%*c:MinusEqual: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:MinusEqual: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_LeftLeftEqual:
-            printf("%*c:LeftLeftEqual: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:LeftLeftEqual: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_RightRightEqual:
-            printf("%*c:RightRightEqual: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:RightRightEqual: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_EtEqual:
-            printf("%*c:EtEqual: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:EtEqual: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_CaretEqual:
-            printf("%*c:CaretEqual: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:CaretEqual: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_PipeEqual:
-            printf("%*c:PipeEqual: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:PipeEqual: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_Comma:
-            printf("%*c:Comma: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:Comma: [%u, %zu, %zu, %zu]\n", depth, ' ', lex.span.len,
+                   pos.file, pos.row, pos.col);
             break;
         case LEX_Hash:
-            printf("%*c:Hash: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:Hash: [%u, %zu, %zu, %zu]\n", depth, ' ', lex.span.len,
+                   pos.file, pos.row, pos.col);
             break;
         case LEX_HashHash:
-            printf("%*c:HashHash: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   lex.span.start, lex.span.len, lex.span.row, lex.span.col);
+            printf("%*c:HashHash: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   lex.span.len, pos.file, pos.row, pos.col);
             break;
         case LEX_Comment:
             break;
@@ -4,6 +4,8 @@
 #ifndef LEXER_H_
 #define LEXER_H_
 
+#include "got.h"
+#include "loc.h"
 #include "vec.h"
 #include <stddef.h>
 #include <stdint.h>
@@ -106,6 +108,7 @@ enum invalid_type {
     IllegalChar,
     IllegalEscapeChar,
     IllegalString,
+    IllegalIntegerTooLarge,
     // Preprocessor
     ExpectedImpossible,       // This should not happen
     ExpectedValidMacro,       // We got something weird
@@ -205,55 +208,183 @@ enum macro_type {
     Error,
     Warning,
     Pragma,
+    IncludeNext, // GNU
 };
 
+// Text in a source buffer
 typedef struct Span {
     char *start;
     size_t len;
-    size_t row;
-    size_t col;
 } Span;
 
-// Span, but with an idx and macro detection
-// It is legal to change row and col as well
+// Where a lex is in the source.
+// Row, col and text are resolved from `loc` only when needed, see loc.h
+typedef struct Range {
+    Loc loc;
+    uint32_t len;
+} Range;
+
+// Text to lex, with an idx and macro detection
 typedef struct Stream {
     char *start;
     size_t len;
-    size_t row;
-    size_t col;
+    Loc base; // Loc of `start`
     size_t idx;
     // see enum macro_type, where InvalidMacro is eqv to no macro
     int macro_line;
 } Stream;
 
+// 16 bytes, constants are too large and go to `Constants` instead.
+// For constant and char types `id` is the idx of their bits there.
 typedef struct Lex {
     enum lex_type type;
-    Span span;
+    Range span;
     union {
         enum lex_keyword key;
         enum macro_type macro;
         enum invalid_type invalid;
-        size_t id;
-        uint64_t constant;
-        double floating;
+        uint32_t id;
     };
 } Lex;
 
-typedef Vector Ids;
+// Interned spans, where the idx into `spans` is the id.
+// `index` maps the contents of a span to its id, so lookups are O(1).
+typedef struct Ids {
+    Vector *spans;
+    Vector *hashes;   // word_hash of each span, reused past the lexer
+    Vector *decoded;  // Malloced UTF-8 of ids that were spelled with UCNs
+    HashTable *index; // IdKey -> id
+} Ids;
+
+// Interned string literals, kept apart from ids and hashed a word at a time.
+// `spans` holds each literal with its quotes but without its prefix.
+// Their code units are decoded only when asked for, see decode_literal,
+// into a pool where equal ones are kept once.
+typedef struct Literals {
+    Vector *spans;
+    HashTable *index;  // IdKey -> literal id
+    Vector *decoded;   // Span for each literal and prefix, 0 until decoded
+    Vector *blocks;    // char *, malloced blocks of the pool, never moved
+    char *pool;        // Free space at the end of the last block
+    size_t pool_left;  // Bytes of it
+    HashTable *unique; // IdKey of decoded units -> their start in the pool
+} Literals;
+
+// Bits of constants, a double for floating ones, where the idx is the id
+typedef struct Constants {
+    Vector *bits; // uint64_t
+} Constants;
+
+// Key of `Ids.index` and `Literals.index`, compared by span contents
+typedef struct IdKey {
+    uint64_t hash;
+    const char *start;
+    size_t len;
+} IdKey;
+
+// Equality of IdKeys for the got tables, by hash and then contents
+int id_key_eq(const void *key, const void *elem_key);
+
 typedef Vector Lexes;
 
+// A whole stream of lexes, one array per field, for a cache friendly walk.
+// `offset` is from the start of the stream, so it must be under 4 GiB.
+// `payload` is the id, key, macro or invalid type of the lex.
+typedef struct Tokens {
+    size_t length;
+    size_t capacity;
+    uint8_t *kind; // enum lex_type
+    uint32_t *offset;
+    uint32_t *len;
+    uint32_t *payload;
+} Tokens;
+
 // Last character must be a newline
-Lex lex_next(Stream *stream, Ids **id_table);
+Lex lex_next(Stream *stream, Ids *id_table, Literals *literals,
+             Constants *constants);
+
+// If the body of `macro` is the rest of its line, ended by LEX_MacroEndToken
+int takes_line(enum macro_type macro);
+
+// Skip a group whose #if* or #elif* condition did not hold, up to the
+// #elif*, #else or #endif ending it, which is returned as LEX_MacroToken.
+// Only a '#' or "%:" starting a line is looked at, the rest is never lexed,
+// and nested groups are skipped whole. LEX_Eof if the stream ends first.
+Lex skip_group(Stream *stream);
+
+// If the rest of `stream` is one #ifndef group, with nothing but spaces and
+// comments around it, the name of its macro is put in `name`.
+// Only its directives are looked at, like skip_group.
+int include_guard(const Stream *stream, Span *name);
 
-Span from_stream(const Stream *stream, size_t len);
-Span from_stream_off(const Stream *stream, ptrdiff_t off, size_t len);
+// lex_next until LEX_Eof, which is appended as well.
+// Resets `tokens` first, so the buffer can be reused for another stream.
+// Returns 0 if the buffers could not grow.
+int lex_file(Stream *stream, Ids *id_table, Literals *literals,
+             Constants *constants, Tokens *tokens);
+
+Range from_stream(const Stream *stream, size_t len);
+Range from_stream_off(const Stream *stream, ptrdiff_t off, size_t len);
 
 Ids *create_ids(size_t capacity);
+void delete_ids(Ids *id_table);
+
+// Check if this id already exists, else push it on
+size_t search_id_table(const Span span, Ids *id_table);
+
+// search_id_table for a span already hashed by word_hash
+size_t search_hashed_id(const Span span, uint64_t hash, Ids *id_table);
+
+// search_hashed_id for a span that is not in the source, copied if new
+size_t search_decoded_id(const Span span, uint64_t hash, Ids *id_table);
+
+// Hash of the span of `id`, to look it up elsewhere without hashing again
+uint64_t id_hash(const Ids *id_table, size_t id);
+
+Literals *create_literals(size_t capacity);
+void delete_literals(Literals *literals);
+
+// Check if this literal already exists, else push it on
+size_t search_literals(const Span span, Literals *literals);
+
+// Code units of literal `id` as a string of `type`, LEX_String up to
+// LEX_StringWide, with escapes and UCNs replaced and a null unit at the end.
+// Units are 1 byte for plain and u8 strings, 2 for u and 4 for U and L,
+// in host order and aligned to their size.
+// Decoded once, then `units` points into the pool until it is deleted.
+// Returns Ok, or IllegalEscapeChar or IllegalString if it cannot be decoded.
+enum invalid_type decode_literal(Literals *literals, uint32_t id,
+                                 enum lex_type type, Span *units);
+
+Constants *create_constants(size_t capacity);
+void delete_constants(Constants *constants);
+
+// Push the bits of a constant, returns its id
+uint32_t push_constant(Constants *constants, uint64_t bits);
+
+uint64_t get_constant(const Constants *constants, uint32_t id);
 
 Lexes *create_lexes(size_t capacity);
 
-void print_lexes(const Lexes *lexes, int depth);
+Tokens *create_tokens(size_t capacity);
+void reset_tokens(Tokens *tokens);
+void delete_tokens(Tokens *tokens);
+
+// Grows with *3/2 like the vectors, returns 0 if it could not
+int grow_tokens(Tokens *tokens);
+
+// Append `lex`, lexed from `stream`. Returns 0 if the buffers could not grow.
+int push_token(Tokens *tokens, const Stream *stream, Lex lex);
+
+// Range of a token lexed from `stream`
+Range token_range(const Tokens *tokens, const Stream *stream, size_t idx);
+
+// With rows and cols of each lex from `locations`
+void print_lexes(const Lexes *lexes, const Constants *constants,
+                 Locations *locations, int depth);
 
 void print_ids(const Ids *id_table);
 
+void print_literals(const Literals *literals);
+
 #endif // LEXER_H_
@@ -0,0 +1,128 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "loc.h"
+#include "scan.h"
+
+Locations *create_locations(size_t capacity) {
+    Locations *locations = malloc(sizeof(*locations));
+    locations->files = create_vec(capacity, sizeof(SourceFile));
+    locations->next = 1;
+    return locations;
+}
+
+void delete_locations(Locations *locations) {
+    for (size_t i = 0; i < locations->files->length; i++) {
+        SourceFile *file = at_elem_vec(locations->files, i);
+        if (file->splices) {
+            delete_vec(file->splices);
+        }
+        if (file->lines) {
+            delete_vec(file->lines);
+        }
+    }
+    delete_vec(locations->files);
+    free(locations);
+}
+
+Loc add_source_file(Locations *locations, const char *start, size_t len,
+                    Vector *splices) {
+    if (len >= UINT32_MAX - locations->next) {
+        if (splices) {
+            delete_vec(splices);
+        }
+        return 0;
+    }
+
+    Loc base = locations->next;
+    push_elem_vec(&locations->files,
+                  &(SourceFile){start, len, base, splices, 0});
+    locations->next += len + 1;
+    return base;
+}
+
+// Line starts of a whole file, newlines found by the SIMD scan.
+// Each splice took a newline out, so it starts a line as well.
+Vector *line_starts(const SourceFile *file) {
+    Vector *lines = create_vec(file->len / 32 + 1, sizeof(uint32_t));
+    const Splice *splices = file->splices ? (Splice *)file->splices->v : 0;
+    size_t count = file->splices ? file->splices->length : 0, next = 0;
+    uint32_t removed = 0, line = 0;
+    push_elem_vec(&lines, &line);
+    for (size_t idx = 0;; idx++) {
+        idx = find_newline(file->start, idx, file->len);
+        for (; next < count && splices[next].offset <= idx; next++) {
+            removed = splices[next].removed;
+            line = splices[next].offset + removed;
+            push_elem_vec(&lines, &line);
+        }
+        if (idx >= file->len) {
+            break;
+        }
+        line = idx + removed + 1;
+        push_elem_vec(&lines, &line);
+    }
+    return lines;
+}
+
+// Offset in the file as written of `offset` in the spliced text
+uint32_t file_offset(const SourceFile *file, uint32_t offset) {
+    if (!file->splices) {
+        return offset;
+    }
+
+    // Last splice at or before `offset`
+    const Splice *splices = (const Splice *)file->splices->v;
+    size_t lo = 0, hi = file->splices->length;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (splices[mid].offset <= offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo ? offset + splices[lo - 1].removed : offset;
+}
+
+Position resolve_loc(Locations *locations, Loc loc) {
+    // Last file with a base at or before `loc`
+    size_t lo = 0, hi = locations->files->length;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        SourceFile *file = at_elem_vec(locations->files, mid);
+        if (file->base <= loc) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (!lo) {
+        return (Position){0};
+    }
+
+    size_t idx = lo - 1;
+    SourceFile *file = at_elem_vec(locations->files, idx);
+    uint32_t offset = loc - file->base;
+    if (offset > file->len) {
+        return (Position){0};
+    } else if (!file->lines) {
+        file->lines = line_starts(file);
+    }
+    offset = file_offset(file, offset);
+
+    // Last line starting at or before `offset`
+    const uint32_t *lines = (const uint32_t *)file->lines->v;
+    lo = 0, hi = file->lines->length;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (lines[mid] <= offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return (Position){idx, lo, offset - lines[lo - 1]};
+}
@@ -0,0 +1,56 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef LOC_H_
+#define LOC_H_
+
+#include "source.h"
+#include "vec.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Source locations.
+// Every file added gets its own range of locs, one per byte and one for its
+// end, so a single Loc says both which file and where in it.
+// Rows and cols are only worked out when asked for, from a table of line
+// starts that each file builds on first use.
+// Locs are in the spliced text the lexer sees, rows and cols are in the file
+// as written, so lines joined by a backslash still count.
+
+typedef uint32_t Loc;
+
+typedef struct SourceFile {
+    const char *start;
+    size_t len;
+    Loc base;
+    Vector *splices; // Splice, 0 if there are none
+    Vector *lines;   // uint32_t file offset of each line start, 0 until used
+} SourceFile;
+
+// All the files in a translation unit, in order of their bases.
+// Loc 0 is never handed out, so it can stand for no location.
+typedef struct Locations {
+    Vector *files; // SourceFile
+    Loc next;
+} Locations;
+
+// Row starts at 1, col at 0, both counted in bytes.
+typedef struct Position {
+    size_t file; // Idx into `Locations.files`
+    size_t row;
+    size_t col;
+} Position;
+
+Locations *create_locations(size_t capacity);
+void delete_locations(Locations *locations);
+
+// Base of `len` bytes at `start`, which must outlive `locations`.
+// `splices` are from splice_source and owned by `locations` after this.
+// Returns 0 if the locs ran out.
+Loc add_source_file(Locations *locations, const char *start, size_t len,
+                    Vector *splices);
+
+// Row is 0 if `loc` is not in any file
+Position resolve_loc(Locations *locations, Loc loc);
+
+#endif // LOC_H_
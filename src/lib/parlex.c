@@ -0,0 +1,312 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "parlex.h"
+#include "scan.h"
+#include <pthread.h>
+#include <string.h>
+
+// Tokens of one chunk, with payloads into its own tables
+typedef struct Chunk {
+    Stream stream; // Where lexing stopped, once lexed
+    size_t start;
+    size_t end; // Lexing stops at the first token ending at or after this
+    Ids *id_table;
+    Literals *literals;
+    Constants *constants;
+    Tokens *tokens;
+
+    // Once joined, tokens from `first` on are copied to `at` in `joined`,
+    // with payloads mapped into the shared tables
+    Tokens *joined;
+    size_t first;
+    size_t at;
+    uint32_t *id_map;
+    uint32_t *literal_map;
+    uint32_t constant_shift;
+
+    pthread_t thread;
+    int threaded;
+    int ok;
+} Chunk;
+
+void *lex_chunk(void *arg) {
+    Chunk *chunk = arg;
+    for (;;) {
+        Lex lex = lex_next(&chunk->stream, chunk->id_table, chunk->literals,
+                           chunk->constants);
+        if (!push_token(chunk->tokens, &chunk->stream, lex)) {
+            return 0;
+        } else if (lex.type == LEX_Eof || chunk->stream.idx >= chunk->end) {
+            chunk->ok = 1;
+            return 0;
+        }
+    }
+}
+
+void *copy_chunk(void *arg) {
+    Chunk *chunk = arg;
+    if (chunk->joined) {
+        const Tokens *from = chunk->tokens;
+        Tokens *to = chunk->joined;
+        size_t first = chunk->first, at = chunk->at;
+        size_t count = from->length - first;
+        memcpy(to->kind + at, from->kind + first, count * sizeof(uint8_t));
+        memcpy(to->offset + at, from->offset + first,
+               count * sizeof(uint32_t));
+        memcpy(to->len + at, from->len + first, count * sizeof(uint32_t));
+
+        for (size_t i = 0; i < count; i++) {
+            uint8_t kind = from->kind[first + i];
+            uint32_t payload = from->payload[first + i];
+            if (kind == LEX_Identifier) {
+                payload = chunk->id_map[payload];
+            } else if (kind >= LEX_String && kind <= LEX_StringWide) {
+                payload = chunk->literal_map[payload];
+            } else if (kind >= LEX_ConstantUnsignedLongLong &&
+                       kind <= LEX_ConstantCharWide) {
+                payload += chunk->constant_shift;
+            }
+            to->payload[at + i] = payload;
+        }
+    }
+    chunk->ok = 1;
+    return 0;
+}
+
+// Run `work` on every chunk, the first on this thread and the others on
+// threads of their own, or here as well if one could not be started.
+// Returns 0 if any of them failed.
+int run_chunks(Chunk *chunks, size_t count, void *work(void *)) {
+    for (size_t i = 0; i < count; i++) {
+        chunks[i].ok = 0;
+    }
+    for (size_t i = 1; i < count; i++) {
+        chunks[i].threaded =
+            !pthread_create(&chunks[i].thread, 0, work, &chunks[i]);
+        if (!chunks[i].threaded) {
+            work(&chunks[i]);
+        }
+    }
+    work(&chunks[0]);
+
+    int ok = 1;
+    for (size_t i = 0; i < count; i++) {
+        if (chunks[i].threaded) {
+            pthread_join(chunks[i].thread, 0);
+        }
+        ok &= chunks[i].ok;
+    }
+    return ok;
+}
+
+// Where a chunk is between two tokens, a guess until it is in step
+typedef struct Cursor {
+    size_t chunk;
+    size_t token; // Next token of the chunk
+    size_t idx;
+    int macro_line;
+} Cursor;
+
+// Move `cursor` up to the first state of a chunk at or past `idx`.
+// Lexing is only decided by idx and macro_line, so once those match the
+// stream, the rest of the chunk is what lexing on would give.
+void seek_cursor(Cursor *cursor, const Chunk *chunks, size_t count,
+                 size_t idx) {
+    while (cursor->chunk < count && cursor->idx < idx) {
+        const Tokens *tokens = chunks[cursor->chunk].tokens;
+        size_t i = cursor->token;
+        if (i < tokens->length && tokens->kind[i] != LEX_Eof) {
+            if (tokens->kind[i] == LEX_MacroToken &&
+                takes_line(tokens->payload[i])) {
+                cursor->macro_line = tokens->payload[i];
+            } else if (tokens->kind[i] == LEX_MacroEndToken) {
+                cursor->macro_line = 0;
+            }
+            cursor->idx = tokens->offset[i] + tokens->len[i];
+            cursor->token += 1;
+        } else if (++cursor->chunk < count) {
+            *cursor = (Cursor){.chunk = cursor->chunk,
+                               .idx = chunks[cursor->chunk].start};
+        }
+    }
+}
+
+// Intern id `local` of `chunk`, spelled at `text` where it is in step.
+// Ids decoded from UCNs are not in the stream, so their UTF-8 is copied.
+uint32_t place_id(const Chunk *chunk, size_t local, char *text,
+                  Ids *id_table) {
+    Span *span = at_elem_vec(chunk->id_table->spans, local);
+    uint64_t hash = id_hash(chunk->id_table, local);
+    if (span->start < chunk->stream.start ||
+        span->start >= chunk->stream.start + chunk->stream.len) {
+        return search_decoded_id(*span, hash, id_table);
+    }
+    return search_hashed_id((Span){text, span->len}, hash, id_table);
+}
+
+// Make room for the tokens of `chunk` from `first` on, and intern their ids,
+// literals and constants in the order lexing in one go would
+int place_chunk(Chunk *chunk, size_t first, Tokens *tokens, Ids *id_table,
+                Literals *literals, Constants *constants) {
+    const Tokens *from = chunk->tokens;
+    size_t count = from->length - first;
+    while (tokens->capacity - tokens->length < count) {
+        if (!grow_tokens(tokens)) {
+            return 0;
+        }
+    }
+    chunk->joined = tokens;
+    chunk->first = first;
+    chunk->at = tokens->length;
+    tokens->length += count;
+
+    size_t ids = chunk->id_table->spans->length;
+    size_t lits = chunk->literals->spans->length;
+    chunk->id_map = malloc((ids + lits + 1) * sizeof(uint32_t));
+    if (!chunk->id_map) {
+        return 0;
+    }
+    chunk->literal_map = chunk->id_map + ids;
+
+    if (!first) {
+        // All in step, so the chunk saw its ids first in the same order
+        for (size_t i = 0; i < ids; i++) {
+            Span *span = at_elem_vec(chunk->id_table->spans, i);
+            chunk->id_map[i] = place_id(chunk, i, span->start, id_table);
+        }
+        for (size_t i = 0; i < lits; i++) {
+            Span *span = at_elem_vec(chunk->literals->spans, i);
+            chunk->literal_map[i] = search_literals(*span, literals);
+        }
+    } else {
+        // Some might have been seen first where the chunk was out of step,
+        // so they are interned at the token in step that uses them first
+        memset(chunk->id_map, 0xFF, (ids + lits) * sizeof(uint32_t));
+        for (size_t i = first; i < from->length; i++) {
+            uint8_t kind = from->kind[i];
+            uint32_t payload = from->payload[i];
+            char *text = chunk->stream.start + from->offset[i];
+            if (kind == LEX_Identifier &&
+                chunk->id_map[payload] == UINT32_MAX) {
+                chunk->id_map[payload] =
+                    place_id(chunk, payload, text, id_table);
+            } else if (kind >= LEX_String && kind <= LEX_StringWide &&
+                       chunk->literal_map[payload] == UINT32_MAX) {
+                // Without its prefix
+                Span *span = at_elem_vec(chunk->literals->spans, payload);
+                text += from->len[i] - span->len;
+                chunk->literal_map[payload] =
+                    search_literals((Span){text, span->len}, literals);
+            }
+        }
+    }
+
+    // A constant is pushed for each constant token, in order
+    uint32_t skipped = 0;
+    for (size_t i = 0; i < first; i++) {
+        skipped += from->kind[i] >= LEX_ConstantUnsignedLongLong &&
+                   from->kind[i] <= LEX_ConstantCharWide;
+    }
+    chunk->constant_shift = constants->bits->length - skipped;
+    for (size_t i = skipped; i < chunk->constants->bits->length; i++) {
+        push_constant(constants, get_constant(chunk->constants, i));
+    }
+    return 1;
+}
+
+// Join the chunks in order, lexing on from where the stream is whenever no
+// chunk is in step with it. Only the tokens lexed here are written, the
+// chunks are placed to be copied after.
+int join_chunks(Stream *stream, Chunk *chunks, size_t count, Ids *id_table,
+                Literals *literals, Constants *constants, Tokens *tokens) {
+    reset_tokens(tokens);
+    Cursor cursor = {0, 0, chunks[0].start, stream->macro_line};
+    for (;;) {
+        seek_cursor(&cursor, chunks, count, stream->idx);
+
+        if (cursor.chunk < count && cursor.idx == stream->idx &&
+            cursor.macro_line == stream->macro_line) {
+            Chunk *chunk = &chunks[cursor.chunk];
+            if (!place_chunk(chunk, cursor.token, tokens, id_table, literals,
+                             constants)) {
+                return 0;
+            }
+
+            *stream = chunk->stream;
+            if (chunk->tokens->kind[chunk->tokens->length - 1] == LEX_Eof) {
+                return 1;
+            } else if (++cursor.chunk < count) {
+                cursor = (Cursor){.chunk = cursor.chunk,
+                                  .idx = chunks[cursor.chunk].start};
+            }
+            continue;
+        }
+
+        Lex lex = lex_next(stream, id_table, literals, constants);
+        if (!push_token(tokens, stream, lex)) {
+            return 0;
+        } else if (lex.type == LEX_Eof) {
+            return 1;
+        }
+    }
+}
+
+int lex_file_parallel(Stream *stream, Ids *id_table, Literals *literals,
+                      Constants *constants, Tokens *tokens, size_t threads) {
+    size_t len = stream->len - stream->idx;
+    size_t count = len / LEX_CHUNK_MIN;
+    count = count < threads ? count : threads;
+    if (count < 2) {
+        return lex_file(stream, id_table, literals, constants, tokens);
+    }
+
+    Chunk *chunks = calloc(count, sizeof(Chunk));
+    if (!chunks) {
+        return 0;
+    }
+
+    // Chunks after the first start at a newline, most likely between tokens
+    size_t chunk_count = 0, start = stream->idx;
+    for (size_t i = 0; i < count && start < stream->len; i++) {
+        size_t end = i + 1 < count
+                         ? find_newline(stream->start,
+                                        stream->idx + len / count * (i + 1),
+                                        stream->len)
+                         : stream->len;
+        if (end <= start) {
+            continue;
+        }
+
+        Stream local = *stream;
+        local.idx = start;
+        local.macro_line = i ? 0 : stream->macro_line;
+        // About a token per 4 bytes, most of them repeated ids or puncts
+        size_t guess = (end - start) / 4 + 64;
+        chunks[chunk_count++] = (Chunk){
+            .stream = local,
+            .start = start,
+            .end = end,
+            .id_table = create_ids(guess / 16),
+            .literals = create_literals(guess / 64),
+            .constants = create_constants(guess / 16),
+            .tokens = create_tokens(guess),
+        };
+        start = end;
+    }
+
+    int ok = run_chunks(chunks, chunk_count, lex_chunk) &&
+             join_chunks(stream, chunks, chunk_count, id_table, literals,
+                         constants, tokens) &&
+             run_chunks(chunks, chunk_count, copy_chunk);
+
+    for (size_t i = 0; i < chunk_count; i++) {
+        delete_ids(chunks[i].id_table);
+        delete_literals(chunks[i].literals);
+        delete_constants(chunks[i].constants);
+        delete_tokens(chunks[i].tokens);
+        free(chunks[i].id_map);
+    }
+    free(chunks);
+    return ok;
+}
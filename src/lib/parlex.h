@@ -0,0 +1,26 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef PARLEX_H_
+#define PARLEX_H_
+
+#include "lexer.h"
+
+// Lexing a large stream on several threads.
+// The stream is split at newlines and the chunks are lexed at once, each
+// with tables of its own and guessing that it starts outside any comment,
+// string or directive line.
+// They are then joined in order. Where a guess was wrong, lexing goes on
+// from the end of the chunk before until it is in step with a chunk again,
+// so only the tokens up to there are lexed twice.
+
+// Smallest chunk worth a thread of its own
+#define LEX_CHUNK_MIN (256 * 1024)
+
+// lex_file on up to `threads` threads, with the same tokens, ids, literals
+// and constants. Small streams are lexed by lex_file.
+// Returns 0 if the buffers could not grow.
+int lex_file_parallel(Stream *stream, Ids *id_table, Literals *literals,
+                      Constants *constants, Tokens *tokens, size_t threads);
+
+#endif // PARLEX_H_
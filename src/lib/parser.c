@@ -3,7 +3,9 @@
    file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include "parser.h"
 #include "lexer.h"
+#include "pch.h"
 #include "pp.h"
+#include "stats.h"
 #include "vec.h"
 #include <stdio.h>
 
@@ -33,6 +35,7 @@ Lex next(Parser *parser) {
 }
 
 void save_ctx(Parser *parser) {
+    STAT_ADD(saves, 1);
     push_elem_vec(&parser->idx_stack, &parser->idx);
 }
 
@@ -43,6 +46,7 @@ void reset_ctx(Parser *parser) {
 }
 
 void return_ctx(Parser *parser) {
+    STAT_ADD(backtracks, 1);
     if (!parser->idx_stack->length) {
         parser->idx = 0;
         return;
@@ -120,7 +124,7 @@ Ast primary_expression(Parser *parser) {
             .span = lex.span,
             .constant = {.type = UnsignedLongLong +
                                  (lex.type - LEX_ConstantUnsignedLongLong),
-                         .c = lex.constant}};
+                         .c = get_constant(parser->pp.constants, lex.id)}};
     default:
         return (Ast){.type = AST_Invalid,
                      .span = lex.span,
@@ -1806,17 +1810,33 @@ Ast parse(Parser *parser) {
 }
 
 // Basically a copy of pp
-Parser *create_parser(String *file_path) {
+Parser *create_parser(Files *files, const char *pch, String *file_path) {
     Parser *parser = malloc(sizeof(*parser));
     parser->ctx = create_lexes(8);
     parser->idx_stack = create_vec(8, sizeof(size_t));
     parser->idx = 0;
     parser->pp.incl_table = create_vec(8, sizeof(IncludeResource));
     parser->pp.incl_stack = create_vec(8, sizeof(size_t));
-    parser->pp.macro_table = create_dht(8, sizeof(size_t), sizeof(DefineMacro));
+    parser->pp.macro_table =
+        create_dht(8, sizeof(MacroKey), sizeof(DefineMacro));
+    parser->pp.files = files;
     parser->pp.id_table = create_ids(8);
+    parser->pp.literals = create_literals(8);
+    parser->pp.constants = create_constants(8);
+    parser->pp.locations = create_locations(8);
+    parser->pp.pch = (Source){0};
     parser->pp.macro_if_depth = 0;
 
+    // Before anything is lexed, so its ids and locs are where they were
+    if (pch) {
+        enum pch_error error = load_pch(&parser->pp, pch, &parser->ctx);
+        if (error) {
+            printf("PCH \"%s\" %s\n", pch, pch_errors[error]);
+            delete_str(file_path);
+            delete_parser(parser);
+            return 0;
+        }
+    }
     include_file(&parser->pp, file_path);
 
     return parser;
@@ -1828,7 +1848,7 @@ void print_parser(Parser *parser) {
         printf(" %zu\n", *(size_t *)at_elem_vec(parser->idx_stack, i));
     }
     printf("context:\n");
-    print_lexes(parser->ctx, 0);
+    print_lexes(parser->ctx, parser->pp.constants, parser->pp.locations, 0);
     printf("pp:\n");
     print_pp(&parser->pp);
     printf(")\n'");
@@ -1838,10 +1858,7 @@ void print_parser(Parser *parser) {
 void delete_parser(Parser *parser) {
     for (size_t i = 0; i < parser->pp.incl_table->length; i++) {
         IncludeResource *resc = at_elem_vec(parser->pp.incl_table, i);
-        if (resc->type == IncludeFile) {
-            delete_str(resc->path);
-            free(resc->stream.start);
-        } else if (resc->type == IncludeMacro) {
+        if (resc->type == IncludeMacro) {
             if (resc->args) {
                 delete_args(resc->args);
             }
@@ -1849,13 +1866,18 @@ void delete_parser(Parser *parser) {
     }
     delete_vec(parser->pp.incl_table);
     delete_vec(parser->pp.incl_stack);
-    delete_vec(parser->pp.id_table);
+    delete_ids(parser->pp.id_table);
+    delete_literals(parser->pp.literals);
+    delete_constants(parser->pp.constants);
+    delete_locations(parser->pp.locations);
     Entry entry;
     size_t idx = 0;
     while ((entry = next_elem_dht(parser->pp.macro_table, &idx)).key) {
         clean_macro(entry.value);
     }
     delete_dht(parser->pp.macro_table);
+    delete_files(parser->pp.files);
+    close_source(&parser->pp.pch);
 
     delete_vec(parser->ctx);
     free(parser);
@@ -1864,157 +1886,152 @@ void delete_parser(Parser *parser) {
 Tree *create_tree(size_t capacity) { return create_vec(capacity, sizeof(Ast)); }
 
 // TODO: Fix spans, currently we just grab the last lex we used for the Ast
-void print_ast(Ast ast, int depth) {
+void print_ast(Ast ast, Locations *locations, int depth) {
+    Position pos = resolve_loc(locations, ast.span.loc);
     switch (ast.type) {
     case AST_EofInvalid:
-        printf("%*c:Ast Eof Error %d: [%p, %zu, %zu, %zu]\n", depth, ' ',
-               ast.invalid, ast.span.start, ast.span.len, ast.span.row,
-               ast.span.col);
+        printf("%*c:Ast Eof Error %d: [%u, %zu, %zu, %zu]\n", depth, ' ',
+               ast.invalid, ast.span.len, pos.file, pos.row, pos.col);
         return;
     case AST_Invalid:
-        printf("%*c:Ast Error %d: [%p, %zu, %zu, %zu]\n", depth, ' ',
-               ast.invalid, ast.span.start, ast.span.len, ast.span.row,
-               ast.span.col);
+        printf("%*c:Ast Error %d: [%u, %zu, %zu, %zu]\n", depth, ' ',
+               ast.invalid, ast.span.len, pos.file, pos.row, pos.col);
         return;
     case AST_Eof:
-        printf("%*c:Ast Eof: [%p, %zu, %zu, %zu]\n", depth, ' ', ast.span.start,
-               ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Ast Eof: [%u, %zu, %zu, %zu]\n", depth, ' ', ast.span.len,
+               pos.file, pos.row, pos.col);
         return;
     case AST_LexList:
-        printf("%*c:LexList: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:LexList: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         if (ast.expr) {
-            print_lexes(ast.lexes, depth + 2);
+            print_lexes(ast.lexes, 0, locations, depth + 2);
         }
         printf("%*c::\n", depth, ' ');
         return;
     case AST_Attribute:
-        printf("%*c:Attribute: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Attribute: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_AttributeList:
-        printf("%*c:AttributeList: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:AttributeList: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         if (ast.expr) {
-            print_tree(ast.expr, depth + 2);
+            print_tree(ast.expr, locations, depth + 2);
         }
         printf("%*c::\n", depth, ' ');
         return;
     case AST_Attributed:
-        printf("%*c:Attributed: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Attributed: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_IdLabel:
-        printf("%*c:IdLabel %zu: [%p, %zu, %zu, %zu] ::\n", depth, ' ', ast.id,
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:IdLabel %zu: [%u, %zu, %zu, %zu] ::\n", depth, ' ', ast.id,
+               ast.span.len, pos.file, pos.row, pos.col);
         return;
     case AST_CaseLabel:
-        printf("%*c:CaseLabel: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:CaseLabel: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_DefaultLabel:
-        printf("%*c:DefaultLabel: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:DefaultLabel: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         return;
     case AST_Labeled:
-        printf("%*c:Labeled: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Labeled: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_StorageSpecifier:
-        printf("%*c:StorageSpecifier %d: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.spec.spec, ast.span.start, ast.span.len, ast.span.row,
-               ast.span.col);
+        printf("%*c:StorageSpecifier %d: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.spec.spec, ast.span.len, pos.file, pos.row, pos.col);
         return;
     case AST_FlatTypeSpecifier:
-        printf("%*c:FlatTypeSpecifier %d: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.spec.spec, ast.span.start, ast.span.len, ast.span.row,
-               ast.span.col);
+        printf("%*c:FlatTypeSpecifier %d: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.spec.spec, ast.span.len, pos.file, pos.row, pos.col);
         return;
     case AST_TypeSpecifier:
-        printf("%*c:TypeSpecifier %d: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.spec.spec, ast.span.start, ast.span.len, ast.span.row,
-               ast.span.col);
+        printf("%*c:TypeSpecifier %d: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.spec.spec, ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_FunctionSpecifier:
-        printf("%*c:FunctionSpecifier %d: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.spec.spec, ast.span.start, ast.span.len, ast.span.row,
-               ast.span.col);
+        printf("%*c:FunctionSpecifier %d: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.spec.spec, ast.span.len, pos.file, pos.row, pos.col);
         return;
     case AST_Specifiers:
-        printf("%*c:Specifiers: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Specifiers: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_InitDecl:
-        printf("%*c:InitDecl: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:InitDecl: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_StaticAssertDecl:
-        printf("%*c:StaticAssert: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:StaticAssert: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_Declarations:
-        printf("%*c:Declarations: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Declarations: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_ExprStat:
-        printf("%*c:Stat; [%p, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.start,
-               ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Stat; [%u, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.len,
+               pos.file, pos.row, pos.col);
         if (ast.expr) {
-            print_tree(ast.expr, depth + 2);
+            print_tree(ast.expr, locations, depth + 2);
         }
         printf("%*c::\n", depth, ' ');
         return;
     case AST_CompStat:
-        printf("%*c:Compound; [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Compound; [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         if (ast.expr) {
-            print_tree(ast.expr, depth + 2);
+            print_tree(ast.expr, locations, depth + 2);
         }
         printf("%*c::\n", depth, ' ');
         return;
     case AST_IfStat:
-        printf("%*c:If; [%p, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.start,
-               ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:If; [%u, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.len,
+               pos.file, pos.row, pos.col);
         break;
     case AST_SwitchStat:
-        printf("%*c:Switch; [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Switch; [%u, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.len,
+               pos.file, pos.row, pos.col);
         break;
     case AST_WhileStat:
-        printf("%*c:While; [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:While; [%u, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.len,
+               pos.file, pos.row, pos.col);
         break;
     case AST_DoWhileStat:
-        printf("%*c:DoWhile; [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:DoWhile; [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_ForStat:
-        printf("%*c:For; [%p, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.start,
-               ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:For; [%u, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.len,
+               pos.file, pos.row, pos.col);
         break;
     case AST_GotoStat:
-        printf("%*c:Goto %zu; [%p, %zu, %zu, %zu] ::\n", depth, ' ', ast.id,
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Goto %zu; [%u, %zu, %zu, %zu] ::\n", depth, ' ', ast.id,
+               ast.span.len, pos.file, pos.row, pos.col);
         return;
     case AST_ContinueStat:
-        printf("%*c:Continue; [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Continue; [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         return;
     case AST_BreakStat:
-        printf("%*c:Break; [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Break; [%u, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.len,
+               pos.file, pos.row, pos.col);
         return;
     case AST_ReturnStat:
-        printf("%*c:Return; [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Return; [%u, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.len,
+               pos.file, pos.row, pos.col);
         if (ast.expr) {
-            print_tree(ast.expr, depth + 2);
+            print_tree(ast.expr, locations, depth + 2);
         }
         printf("%*c::\n", depth, ' ');
         return;
     case AST_Identifier:
-        printf("%*c:Id %zu: [%p, %zu, %zu, %zu]\n", depth, ' ', ast.id,
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Id %zu: [%u, %zu, %zu, %zu]\n", depth, ' ', ast.id,
+               ast.span.len, pos.file, pos.row, pos.col);
         return;
     case AST_Constant:
         switch (ast.constant.type) {
@@ -2029,195 +2046,192 @@ void print_ast(Ast ast, int depth) {
         case Decimal32:
         case Decimal64:
         case Decimal128:
-            printf("%*c:Constant%d val: %zu: [%p, %zu, %zu, %zu]\n", depth, ' ',
-                   ast.constant.type, ast.constant.c, ast.span.start,
-                   ast.span.len, ast.span.row, ast.span.col);
+            printf("%*c:Constant%d val: %zu: [%u, %zu, %zu, %zu]\n", depth, ' ',
+                   ast.constant.type, ast.constant.c, ast.span.len, pos.file,
+                   pos.row, pos.col);
             return;
         case Char:
         case CharU8:
         case CharU16:
         case CharU32:
         case CharWide:
-            printf("%*c:ConstantChar%d val: %zu: [%p, %zu, %zu, %zu]\n", depth,
-                   ' ', ast.constant.type, ast.constant.c, ast.span.start,
-                   ast.span.len, ast.span.row, ast.span.col);
+            printf("%*c:ConstantChar%d val: %zu: [%u, %zu, %zu, %zu]\n", depth,
+                   ' ', ast.constant.type, ast.constant.c, ast.span.len,
+                   pos.file, pos.row, pos.col);
             return;
         case Float:
         case Double:
         case LongDouble:
-            printf("%*c:ConstantFloat%d val: %f: [%p, %zu, %zu, %zu]\n", depth,
-                   ' ', ast.constant.type, ast.constant.d, ast.span.start,
-                   ast.span.len, ast.span.row, ast.span.col);
+            printf("%*c:ConstantFloat%d val: %f: [%u, %zu, %zu, %zu]\n", depth,
+                   ' ', ast.constant.type, ast.constant.d, ast.span.len,
+                   pos.file, pos.row, pos.col);
             return;
         }
     case AST_String:
-        printf("%*c:String%d id: %zu: [%p, %zu, %zu, %zu]\n", depth, ' ',
-               ast.string.type, ast.string.id, ast.span.start, ast.span.len,
-               ast.span.row, ast.span.col);
+        printf("%*c:String%d id: %zu: [%u, %zu, %zu, %zu]\n", depth, ' ',
+               ast.string.type, ast.string.id, ast.span.len, pos.file, pos.row,
+               pos.col);
         return;
     case AST_Expr:
-        printf("%*c:Expr: [%p, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.start,
-               ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Expr: [%u, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.len,
+               pos.file, pos.row, pos.col);
         break;
     case AST_AssignExpr:
-        printf("%*c:Assign%d: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.assign.op, ast.span.start, ast.span.len, ast.span.row,
-               ast.span.col);
+        printf("%*c:Assign%d: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.assign.op, ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_CondExpr:
-        printf("%*c:Condition: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Condition: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_LogOrExpr:
-        printf("%*c:LogicalOr: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:LogicalOr: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_LogAndExpr:
-        printf("%*c:LogicalAnd: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:LogicalAnd: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_InclOrExpr:
-        printf("%*c:InclusiveOr: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:InclusiveOr: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_ExclOrExpr:
-        printf("%*c:ExclusiveOr: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:ExclusiveOr: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_AndExpr:
-        printf("%*c:And: [%p, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.start,
-               ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:And: [%u, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.len,
+               pos.file, pos.row, pos.col);
         break;
     case AST_EqualExpr:
-        printf("%*c:Equal: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Equal: [%u, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.len,
+               pos.file, pos.row, pos.col);
         break;
     case AST_NotEqualExpr:
-        printf("%*c:NotEqual: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:NotEqual: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_LessExpr:
-        printf("%*c:Less: [%p, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.start,
-               ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Less: [%u, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.len,
+               pos.file, pos.row, pos.col);
         break;
     case AST_GreaterExpr:
-        printf("%*c:Greater: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Greater: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_LessEqExpr:
-        printf("%*c:LessEqual: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:LessEqual: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_GreaterEqExpr:
-        printf("%*c:GreaterEqual: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:GreaterEqual: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_ShiftLeftExpr:
-        printf("%*c:ShiftLeft: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:ShiftLeft: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_ShiftRightExpr:
-        printf("%*c:ShiftRight: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:ShiftRight: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_AddExpr:
-        printf("%*c:Add: [%p, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.start,
-               ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Add: [%u, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.len,
+               pos.file, pos.row, pos.col);
         break;
     case AST_SubExpr:
-        printf("%*c:Sub: [%p, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.start,
-               ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Sub: [%u, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.len,
+               pos.file, pos.row, pos.col);
         break;
     case AST_MultExpr:
-        printf("%*c:Mult: [%p, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.start,
-               ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Mult: [%u, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.len,
+               pos.file, pos.row, pos.col);
         break;
     case AST_DivExpr:
-        printf("%*c:Div: [%p, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.start,
-               ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Div: [%u, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.len,
+               pos.file, pos.row, pos.col);
         break;
     case AST_ModExpr:
-        printf("%*c:Mod: [%p, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.start,
-               ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Mod: [%u, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.len,
+               pos.file, pos.row, pos.col);
         break;
     case AST_CastExpr:
-        printf("%*c:Cast: [%p, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.start,
-               ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Cast: [%u, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.len,
+               pos.file, pos.row, pos.col);
         // TODO: This should be a type
-        print_ast(*(Ast *)at_elem_vec(ast.expr, 0), depth + 2);
-        print_ast(*(Ast *)at_elem_vec(ast.expr, 1), depth + 2);
+        print_ast(*(Ast *)at_elem_vec(ast.expr, 0), locations, depth + 2);
+        print_ast(*(Ast *)at_elem_vec(ast.expr, 1), locations, depth + 2);
         printf("%*c::\n", depth, ' ');
         return;
     case AST_PreIncExpr:
-        printf("%*c:PreInc: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:PreInc: [%u, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.len,
+               pos.file, pos.row, pos.col);
         break;
     case AST_PreDecExpr:
-        printf("%*c:PreDec: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:PreDec: [%u, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.len,
+               pos.file, pos.row, pos.col);
         break;
     case AST_RefExpr:
-        printf("%*c:RefExpr: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:RefExpr: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_DerefExpr:
-        printf("%*c:DerefExpr: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:DerefExpr: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_NegExpr:
-        printf("%*c:NegExpr: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:NegExpr: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_InvExpr:
-        printf("%*c:InvExpr: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:InvExpr: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_NotExpr:
-        printf("%*c:NotExpr: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:NotExpr: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_SizeofExpr:
-        printf("%*c:SizeofExpr: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:SizeofExpr: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_AlignofExpr:
-        printf("%*c:AlignofExpr: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:AlignofExpr: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_ArrAccessExpr:
-        printf("%*c:ArrAccess: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:ArrAccess: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_CallExpr:
-        printf("%*c:Call: [%p, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.start,
-               ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:Call: [%u, %zu, %zu, %zu] ::\n", depth, ' ', ast.span.len,
+               pos.file, pos.row, pos.col);
         break;
     case AST_AccessExpr:
-        printf("%*c:Access %zu: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.access.id, ast.span.start, ast.span.len, ast.span.row,
-               ast.span.col);
+        printf("%*c:Access %zu: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.access.id, ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_DerefAccessExpr:
-        printf("%*c:DerefAccess %zu: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.access.id, ast.span.start, ast.span.len, ast.span.row,
-               ast.span.col);
+        printf("%*c:DerefAccess %zu: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.access.id, ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_PostIncExpr:
-        printf("%*c:PostInc: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:PostInc: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     case AST_PostDecExpr:
-        printf("%*c:PostDec: [%p, %zu, %zu, %zu] ::\n", depth, ' ',
-               ast.span.start, ast.span.len, ast.span.row, ast.span.col);
+        printf("%*c:PostDec: [%u, %zu, %zu, %zu] ::\n", depth, ' ',
+               ast.span.len, pos.file, pos.row, pos.col);
         break;
     }
-    print_tree(ast.expr, depth + 2);
+    print_tree(ast.expr, locations, depth + 2);
     printf("%*c::\n", depth, ' ');
 }
 
-void print_tree(Tree *tree, int depth) {
+void print_tree(Tree *tree, Locations *locations, int depth) {
     for (uint64_t i = 0; i < tree->length; i++) {
-        print_ast(*(Ast *)at_elem_vec((Tree *)tree, i), depth);
+        print_ast(*(Ast *)at_elem_vec((Tree *)tree, i), locations, depth);
     }
 }
 
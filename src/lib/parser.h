@@ -197,7 +197,7 @@ enum inv_type {
 // Better performance, easier to free, etc.
 typedef struct Ast {
     enum ast_type type;
-    Span span;
+    Range span;
     union {
         Tree *expr; // General option, contents depend on type
         Lexes *lexes;
@@ -239,15 +239,18 @@ typedef struct Parser {
 
 Ast parse(Parser *pp);
 
-Parser *create_parser(String *file_path);
+// Takes `files`, with its search path set.
+// With `pch`, that snapshot is loaded first, see pch.h.
+// Returns 0 if it could not be.
+Parser *create_parser(Files *files, const char *pch, String *file_path);
 void print_parser(Parser *parser);
 void delete_parser(Parser *parser);
 
 Tree *create_tree(size_t capacity);
-void print_tree(Tree *tree, int depth);
+void print_tree(Tree *tree, Locations *locations, int depth);
 void delete_tree(Tree *tree);
 
-void print_ast(Ast ast, int depth);
+void print_ast(Ast ast, Locations *locations, int depth);
 void delete_ast(Ast ast);
 
 #endif // PARSER_H_
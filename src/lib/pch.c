@@ -0,0 +1,338 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "pch.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// "dfccpch" and a version, bumped whenever the layout changes
+#define PCH_MAGIC 0x0168637063636664ull
+#define PCH_NONE UINT64_MAX
+
+const char *const pch_errors[PchStale + 1] = {
+    [PchNotFound] = "could not be read",
+    [PchInvalid] = "is not a snapshot from this build",
+    [PchStale] = "is out of date",
+};
+
+// `count` records at `offset` in the snapshot
+typedef struct PchTable {
+    uint64_t offset;
+    uint64_t count;
+} PchTable;
+
+// At offset 0, followed by the records of each table, then everything
+// records point to, each aligned to 8 bytes
+typedef struct PchHeader {
+    uint64_t magic;
+    uint64_t lex_size; // Lexes are kept as they are, so it must match
+    uint64_t size;     // Of the whole snapshot, so a cut one is not used
+    PchTable files;     // PchFile
+    PchTable ids;       // PchText
+    PchTable literals;  // PchText
+    PchTable constants; // uint64_t
+    PchTable macros;    // PchMacro
+    PchTable tokens;    // Lex
+} PchHeader;
+
+// `len` bytes at `offset`, with the word_hash of ids
+typedef struct PchText {
+    uint64_t offset;
+    uint64_t len;
+    uint64_t hash;
+} PchText;
+
+typedef struct PchFile {
+    PchText path; // As spelled, followed by a null
+    uint64_t size;
+    uint64_t mtime_sec;
+    uint64_t mtime_nsec;
+    uint64_t len;  // Spliced
+    uint64_t base; // In Locations
+    uint64_t hash; // word_hash of the spliced text
+    uint64_t guard; // PCH_NONE if it has none
+    uint64_t once;
+} PchFile;
+
+typedef struct PchMacro {
+    uint64_t mid;
+    PchTable args;  // uint64_t mids, `count` is PCH_NONE if it takes none
+    PchTable lexes; // Lex
+} PchMacro;
+
+// Align `out` to 8 bytes, returns where the next bytes go
+uint64_t align_pch(String **out) {
+    while ((*out)->length % 8) {
+        push_elem_str(out, 0);
+    }
+    return (*out)->length;
+}
+
+// Append `len` bytes aligned to 8, returns their offset
+uint64_t put_pch(String **out, const void *data, size_t len) {
+    uint64_t offset = align_pch(out);
+    push_slice_str(out, (char *)data, len);
+    return offset;
+}
+
+// Fill in record `i` of `table`, its room was made up front
+void put_record(String *out, PchTable table, size_t i, const void *record,
+                size_t size) {
+    memcpy(out->s + table.offset + i * size, record, size);
+}
+
+int put_file(String **out, PchTable table, size_t i, const File *file) {
+    struct stat st_buf;
+    if (stat(file->path->s, &st_buf)) {
+        return 1;
+    }
+    uint64_t path = put_pch(out, file->path->s, file->path->length);
+    PchFile record = {
+        .path = {path, file->path->length - 1, 0},
+        .size = st_buf.st_size,
+        .mtime_sec = st_buf.st_mtim.tv_sec,
+        .mtime_nsec = st_buf.st_mtim.tv_nsec,
+        .len = file->source.len,
+        .base = file->base,
+        .hash = word_hash((uint8_t *)file->source.start, file->source.len),
+        .guard = file->guard == NO_GUARD ? PCH_NONE : file->guard,
+        .once = file->once,
+    };
+    put_record(*out, table, i, &record, sizeof(record));
+    return 0;
+}
+
+void put_macro(String **out, PchTable table, size_t i, size_t mid,
+               const DefineMacro *macro) {
+    PchMacro record = {.mid = mid, .args = {0, PCH_NONE}};
+    if (macro->args) {
+        record.args = (PchTable){align_pch(out), macro->args->length};
+        for (size_t j = 0; j < macro->args->length; j++) {
+            uint64_t arg = *(size_t *)at_elem_vec(macro->args, j);
+            push_slice_str(out, (char *)&arg, sizeof(arg));
+        }
+    }
+    if (macro->lexes) {
+        record.lexes = (PchTable){
+            put_pch(out, macro->lexes->v, macro->lexes->length * sizeof(Lex)),
+            macro->lexes->length};
+    }
+    put_record(*out, table, i, &record, sizeof(record));
+}
+
+// Lay the tables out after the header, returns where they end
+uint64_t place_tables(PchHeader *header, const Preprocessor *pp) {
+    uint64_t at = sizeof(*header);
+    PchTable *tables[] = {&header->files, &header->ids, &header->literals,
+                          &header->constants, &header->macros};
+    size_t counts[] = {pp->files->files->length, pp->id_table->spans->length,
+                       pp->literals->spans->length,
+                       pp->constants->bits->length, pp->macro_table->length};
+    size_t sizes[] = {sizeof(PchFile), sizeof(PchText), sizeof(PchText),
+                      sizeof(uint64_t), sizeof(PchMacro)};
+    for (size_t i = 0; i < sizeof(tables) / sizeof(tables[0]); i++) {
+        *tables[i] = (PchTable){at, counts[i]};
+        at += counts[i] * sizes[i];
+    }
+    return at;
+}
+
+int emit_pch(Preprocessor *pp, const char *path) {
+    Lexes *tokens = create_lexes(64);
+    for (Lex lex = pp_lex_next(pp); lex.type != LEX_Eof;
+         lex = pp_lex_next(pp)) {
+        push_elem_vec(&tokens, &lex);
+    }
+
+    PchHeader header = {.magic = PCH_MAGIC, .lex_size = sizeof(Lex)};
+    uint64_t records = place_tables(&header, pp);
+    // Zeroed by create_str, the records are filled in below
+    String *out = create_str(records + 4096);
+    out->length = records;
+
+    int error = 0;
+    for (size_t i = 0; !error && i < header.files.count; i++) {
+        error = put_file(&out, header.files, i, get_file(pp->files, i));
+    }
+    for (size_t i = 0; i < header.ids.count; i++) {
+        Span *span = at_elem_vec(pp->id_table->spans, i);
+        PchText record = {put_pch(&out, span->start, span->len), span->len,
+                          id_hash(pp->id_table, i)};
+        put_record(out, header.ids, i, &record, sizeof(record));
+    }
+    for (size_t i = 0; i < header.literals.count; i++) {
+        Span *span = at_elem_vec(pp->literals->spans, i);
+        PchText record = {put_pch(&out, span->start, span->len), span->len,
+                          0};
+        put_record(out, header.literals, i, &record, sizeof(record));
+    }
+    for (size_t i = 0; i < header.constants.count; i++) {
+        uint64_t bits = get_constant(pp->constants, i);
+        put_record(out, header.constants, i, &bits, sizeof(bits));
+    }
+    Entry entry;
+    size_t idx = 0;
+    for (size_t i = 0; (entry = next_elem_dht(pp->macro_table, &idx)).key;
+         i++) {
+        put_macro(&out, header.macros, i, ((MacroKey *)entry.key)->mid,
+                  entry.value);
+    }
+    header.tokens = (PchTable){
+        put_pch(&out, tokens->v, tokens->length * sizeof(Lex)),
+        tokens->length};
+    delete_vec(tokens);
+
+    header.size = out->length;
+    memcpy(out->s, &header, sizeof(header));
+
+    FILE *file = error ? 0 : fopen(path, "wb");
+    if (!file || fwrite(out->s, 1, out->length, file) != out->length) {
+        error = 1;
+    }
+    if (file && fclose(file)) {
+        error = 1;
+    }
+    delete_str(out);
+    return error;
+}
+
+// `count` items of `size` bytes at `offset`, 0 if they are not all in `pch`
+const void *pch_at(const Source *pch, uint64_t offset, uint64_t count,
+                   size_t size) {
+    if (offset > pch->len || count > (pch->len - offset) / size) {
+        return 0;
+    }
+    return pch->start + offset;
+}
+
+// Add the file of `record` again, as it was if it did not change
+enum pch_error load_file(Preprocessor *pp, const Source *pch,
+                         const PchFile *record) {
+    const char *path =
+        pch_at(pch, record->path.offset, record->path.len + 1, 1);
+    if (!path || path[record->path.len] ||
+        (record->guard != PCH_NONE &&
+         record->guard >= pp->id_table->spans->length)) {
+        return PchInvalid;
+    }
+
+    struct stat st_buf;
+    size_t idx;
+    if (stat(path, &st_buf) || (uint64_t)st_buf.st_size != record->size ||
+        find_file(pp->files, path, record->path.len, pp->locations, &idx)) {
+        return PchStale;
+    }
+    File *file = get_file(pp->files, idx);
+    if (file->base != record->base || file->source.len != record->len) {
+        return PchStale;
+    }
+    // Touched, but maybe not changed
+    if (((uint64_t)st_buf.st_mtim.tv_sec != record->mtime_sec ||
+         (uint64_t)st_buf.st_mtim.tv_nsec != record->mtime_nsec) &&
+        word_hash((uint8_t *)file->source.start, file->source.len) !=
+            record->hash) {
+        return PchStale;
+    }
+
+    file->guard = record->guard == PCH_NONE ? NO_GUARD : record->guard;
+    file->once = record->once;
+    return PchOk;
+}
+
+enum pch_error load_macro(Preprocessor *pp, const Source *pch,
+                          const PchMacro *record) {
+    size_t ids = pp->id_table->spans->length;
+    const Lex *body =
+        pch_at(pch, record->lexes.offset, record->lexes.count, sizeof(Lex));
+    const uint64_t *mids =
+        record->args.count == PCH_NONE
+            ? 0
+            : pch_at(pch, record->args.offset, record->args.count,
+                     sizeof(uint64_t));
+    if (record->mid >= ids || !body ||
+        (!mids && record->args.count != PCH_NONE)) {
+        return PchInvalid;
+    }
+
+    IdsRef *args = 0;
+    if (mids) {
+        args = create_idsref(record->args.count);
+        for (size_t i = 0; i < record->args.count; i++) {
+            push_elem_vec(&args, &(size_t){mids[i]});
+        }
+    }
+    Lexes *lexes = create_lexes(record->lexes.count);
+    push_slice_vec(&lexes, body, record->lexes.count);
+
+    MacroKey key = {id_hash(pp->id_table, record->mid), record->mid};
+    put_hashed_elem_dht(&pp->macro_table, &key,
+                        &(DefineMacro){.args = args, .lexes = lexes},
+                        macro_key_eq);
+    return PchOk;
+}
+
+enum pch_error load_pch(Preprocessor *pp, const char *path, Lexes **tokens) {
+    Source *pch = &pp->pch;
+    if (open_source(path, pch)) {
+        return PchNotFound;
+    }
+    const PchHeader *header = pch_at(pch, 0, 1, sizeof(PchHeader));
+    if (!header || header->magic != PCH_MAGIC ||
+        header->lex_size != sizeof(Lex) || header->size != pch->len) {
+        return PchInvalid;
+    }
+    const PchFile *files = pch_at(pch, header->files.offset,
+                                  header->files.count, sizeof(PchFile));
+    const PchText *ids = pch_at(pch, header->ids.offset, header->ids.count,
+                                sizeof(PchText));
+    const PchText *literals =
+        pch_at(pch, header->literals.offset, header->literals.count,
+               sizeof(PchText));
+    const uint64_t *constants =
+        pch_at(pch, header->constants.offset, header->constants.count,
+               sizeof(uint64_t));
+    const PchMacro *macros = pch_at(pch, header->macros.offset,
+                                    header->macros.count, sizeof(PchMacro));
+    const Lex *lexes = pch_at(pch, header->tokens.offset,
+                              header->tokens.count, sizeof(Lex));
+    if (!files || !ids || !literals || !constants || !macros || !lexes) {
+        return PchInvalid;
+    }
+
+    // Interned in order into empty tables, each gets the id it had
+    for (size_t i = 0; i < header->ids.count; i++) {
+        const char *text = pch_at(pch, ids[i].offset, ids[i].len, 1);
+        if (!text || search_hashed_id((Span){(char *)text, ids[i].len},
+                                      ids[i].hash, pp->id_table) != i) {
+            return PchInvalid;
+        }
+    }
+    for (size_t i = 0; i < header->literals.count; i++) {
+        const char *text =
+            pch_at(pch, literals[i].offset, literals[i].len, 1);
+        if (!text || search_literals((Span){(char *)text, literals[i].len},
+                                     pp->literals) != i) {
+            return PchInvalid;
+        }
+    }
+    for (size_t i = 0; i < header->constants.count; i++) {
+        push_constant(pp->constants, constants[i]);
+    }
+
+    // Added in the order they were read, so they get the same bases
+    for (size_t i = 0; i < header->files.count; i++) {
+        enum pch_error error = load_file(pp, pch, &files[i]);
+        if (error) {
+            return error;
+        }
+    }
+    for (size_t i = 0; i < header->macros.count; i++) {
+        enum pch_error error = load_macro(pp, pch, &macros[i]);
+        if (error) {
+            return error;
+        }
+    }
+    push_slice_vec(tokens, lexes, header->tokens.count);
+    return PchOk;
+}
@@ -0,0 +1,38 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef PCH_H_
+#define PCH_H_
+
+#include "pp.h"
+
+// Precompiled headers, snapshots of the preprocessor after a header.
+// A snapshot holds the ids, literals, constants and macros the header left,
+// the guard and #pragma once of each file it read, and the tokens it gave.
+// It refers to itself only by offsets, so it is used where it is mapped:
+// spans of ids and literals point into it, ids keep the hashes taken when
+// they were lexed, and macro bodies and tokens are copied out in one go.
+// Lexes keep their locs, as its files are added to Locations again in the
+// same order, which they are checked against. A file of another size is out
+// of date, one with another mtime is compared by its content hash.
+
+enum pch_error {
+    PchOk = 0,
+    PchNotFound,
+    PchInvalid, // Not a snapshot, or from another build
+    PchStale,   // One of its files changed or is gone
+};
+
+// Why a snapshot could not be loaded, by pch_error
+extern const char *const pch_errors[PchStale + 1];
+
+// Preprocess the rest of `pp` and write the snapshot to `path`.
+// Returns 1 if it could not be written.
+int emit_pch(Preprocessor *pp, const char *path);
+
+// Load the snapshot at `path` into `pp`, which must not have lexed anything
+// yet, and push the tokens of its header onto `tokens`.
+// `pp->pch` keeps it mapped until the preprocessor is deleted.
+enum pch_error load_pch(Preprocessor *pp, const char *path, Lexes **tokens);
+
+#endif // PCH_H_
@@ -4,92 +4,58 @@
 #include "pp.h"
 #include "got.h"
 #include "lexer.h"
+#include "scan.h"
+#include "stats.h"
 #include "vec.h"
 #include <fcntl.h>
-#include <linux/limits.h>
 #include <stdio.h>
 #include <string.h>
-#include <sys/stat.h>
 
 Lex lex_next_top_expand(Preprocessor *pp);
 IncludeResource *get_top_resc(Preprocessor *pp);
 Lex include_macro(Preprocessor *pp, IncludeResource partial);
 
-Lex macro_include_file(Preprocessor *pp) {
+Lex macro_include_file(Preprocessor *pp, int next) {
     IncludeResource *top = get_top_resc(pp);
     if (top->type != IncludeFile) {
         return (Lex){.type = LEX_Invalid, .invalid = ExpectedFileNotMacro};
     }
 
-    Lex lex = lex_next(&top->stream, &pp->id_table);
+    Lex lex = lex_next(&top->stream, pp->id_table, pp->literals,
+                       pp->constants);
+    Span name;
     if (lex.type == LEX_Left) {
-        Span str = {.start = lex.span.start + 1, .len = 0};
-        while (str.start[str.len] != '>') {
-            if (str.start[str.len] == '\n') {
+        name = (Span){.start = top->stream.start + top->stream.idx, .len = 0};
+        while (name.start[name.len] != '>') {
+            if (name.start[name.len] == '\n') {
                 return (Lex){.type = LEX_Invalid,
-                             .span = str,
+                             .span = {lex.span.loc + 1, name.len},
                              .invalid = ExpectedValidIncludeFile};
             }
-            str.len += 1;
+            name.len += 1;
             top->stream.idx += 1;
-            top->stream.col += 1;
         }
         top->stream.idx += 1;
-        top->stream.col += 1;
 
-        if (!str.len) {
+        if (!name.len) {
             return (Lex){.type = LEX_Invalid,
-                         .span = str,
+                         .span = {lex.span.loc + 1, name.len},
                          .invalid = ExpectedValidIncludeFile};
         }
-
-        char path[PATH_MAX];
-
-        // TODO: We actually need to check system path like /usr/local, etc.
-        // Also the pathes included with -Ipath
-        realpath(top->path->s, path);
-        size_t path_len = strlen(path);
-
-        for (; path[path_len] != '/'; path_len--)
-            ;
-
-        memcpy(path + path_len + 1, str.start, str.len);
-        path[path_len + 1 + str.len] = '\0';
-
-        String *file_path = from_cstr(path);
-
-        if (include_file(pp, file_path)) {
-            return (Lex){.type = LEX_Invalid,
-                         .invalid = ExpectedValidIncludeFile};
-        } else {
-            return pp_lex_next(pp);
-        }
     } else if (lex.type == LEX_String) {
-        char path[PATH_MAX];
-        Span str = *(Span *)at_elem_vec(pp->id_table, lex.id);
-
-        realpath(top->path->s, path);
-        size_t path_len = strlen(path);
-
-        for (; path[path_len] != '/'; path_len--)
-            ;
-
-        memcpy(path + path_len + 1, str.start + 1, str.len - 2);
-        path[path_len + str.len - 1] = '\0';
-
-        String *file_path = from_cstr(path);
-
-        if (include_file(pp, file_path)) {
-            return (Lex){.type = LEX_Invalid,
-                         .invalid = ExpectedValidIncludeFile};
-        } else {
-            return pp_lex_next(pp);
-        }
+        // A header name is not a string, its escapes are taken as they are
+        Span str = *(Span *)at_elem_vec(pp->literals->spans, lex.id);
+        name = (Span){.start = str.start + 1, .len = str.len - 2};
     } else {
         return (Lex){.type = LEX_Invalid,
                      .span = lex.span,
                      .invalid = ExpectedIncludeHeader};
     }
+
+    if (include_name(pp, name, lex.type == LEX_Left, next)) {
+        return (Lex){.type = LEX_Invalid, .invalid = ExpectedValidIncludeFile};
+    }
+    return pp_lex_next(pp);
 }
 
 Lex lex_next_top(Preprocessor *pp) {
@@ -97,12 +63,11 @@ Lex lex_next_top(Preprocessor *pp) {
         IncludeResource *resc = get_top_resc(pp);
         Lex lex;
         if (resc->type == IncludeFile) {
-            lex = lex_next(&resc->stream, &pp->id_table);
+            lex = lex_next(&resc->stream, pp->id_table, pp->literals,
+                           pp->constants);
 
             if (lex.type == LEX_Eof) {
                 resc->stream.idx = 0;
-                resc->stream.col = 0;
-                resc->stream.row = 0;
                 resc->stream.macro_line = 0;
                 pop_elem_vec(pp->incl_stack);
                 return lex_next_top(pp);
@@ -123,13 +88,26 @@ Lex lex_next_top(Preprocessor *pp) {
     return (Lex){.type = LEX_Eof};
 }
 
+int macro_key_eq(const void *key, const void *elem_key) {
+    return ((const MacroKey *)key)->mid == ((const MacroKey *)elem_key)->mid;
+}
+
+MacroKey macro_key(const Preprocessor *pp, size_t mid) {
+    return (MacroKey){id_hash(pp->id_table, mid), mid};
+}
+
+DefineMacro *get_macro(Preprocessor *pp, size_t mid) {
+    MacroKey key = macro_key(pp, mid);
+    return get_hashed_elem_dht(pp->macro_table, &key, macro_key_eq);
+}
+
 // NOTE: A bit of IncludeResource abuse below
 IncludeResource scan_macros(Preprocessor *pp, size_t id) {
     for (size_t i = pp->incl_stack->length - 1; i != (size_t)-1; --i) {
         size_t idx = *(size_t *)at_elem_vec(pp->incl_stack, i);
         IncludeResource *resc = at_elem_vec(pp->incl_table, idx);
         if (resc->type == IncludeMacro) {
-            DefineMacro *macro = get_elem_dht(pp->macro_table, &resc->mid);
+            DefineMacro *macro = get_macro(pp, resc->mid);
             if (macro && macro->args) {
                 for (size_t j = 0; j < macro->args->length; j++) {
                     size_t idx = *(size_t *)at_elem_vec(macro->args, j);
@@ -147,7 +125,7 @@ IncludeResource scan_macros(Preprocessor *pp, size_t id) {
         }
     }
 
-    DefineMacro *macro = get_elem_dht(pp->macro_table, &id);
+    DefineMacro *macro = get_macro(pp, id);
     if (macro) {
         Args *args = 0;
         if (macro->args) {
@@ -201,7 +179,7 @@ Lex define_macro(Preprocessor *pp) {
 
     size_t mid = lex.id;
     Lexes *lexes = create_lexes(0);
-    Ids *args = 0;
+    IdsRef *args = 0;
 
     lex = lex_next_top_expand(pp);
     // TODO: This must be next to id, no space allowed
@@ -215,7 +193,7 @@ Lex define_macro(Preprocessor *pp) {
             if (lex.type == LEX_Comma || lex.type == LEX_RParen) {
             } else if ((prev.type == LEX_LParen || prev.type == LEX_Comma) &&
                        lex.type == LEX_Identifier) {
-                push_elem_vec(&args, &lex.id);
+                push_elem_vec(&args, &(size_t){lex.id});
             } else {
                 delete_vec(lexes);
                 delete_vec(args);
@@ -236,33 +214,31 @@ Lex define_macro(Preprocessor *pp) {
         lex = lex_next_top_expand(pp);
     }
 
-    put_elem_dht(&pp->macro_table, &mid,
-                 &(DefineMacro){.args = args, .lexes = lexes});
+    MacroKey key = macro_key(pp, mid);
+    put_hashed_elem_dht(&pp->macro_table, &key,
+                        &(DefineMacro){.args = args, .lexes = lexes},
+                        macro_key_eq);
 
     return pp_lex_next(pp);
 }
 
-// TODO: We do not need to actually lex the stream
-// Requires augments to the lexer
+// Skipped groups are never lexed, see skip_group.
 // `else_clause` is for when we took a branch already and just need to endif
-Lex skip_if_clause(Preprocessor *pp, size_t depth, int else_clause) {
+Lex skip_if_clause(Preprocessor *pp, int else_clause) {
+    IncludeResource *top = get_top_resc(pp);
+    if (top->type != IncludeFile) {
+        return (Lex){.type = LEX_Invalid, .invalid = ExpectedFileNotMacro};
+    }
+
     Lex lex;
     do {
-        lex = lex_next_top(pp);
-    } while (lex.type != LEX_MacroToken);
-
-    if (else_clause) {
-        do {
-            lex = lex_next_top(pp);
-            if (lex.type == LEX_Eof) {
-                return (Lex){.type = LEX_Invalid,
-                             .span = lex.span,
-                             .invalid = ExpectedIfEndIf};
-            }
-        } while (lex.type != LEX_MacroToken && lex.macro != EndIf);
-
-        return pp_lex_next(pp);
-    }
+        lex = skip_group(&top->stream);
+        if (lex.type == LEX_Eof) {
+            return (Lex){.type = LEX_Invalid,
+                         .span = lex.span,
+                         .invalid = ExpectedIfEndIf};
+        }
+    } while (else_clause && lex.macro != EndIf);
 
     // NOTE: We can only be here if we did not take the previous branches
     switch (lex.macro) {
@@ -272,11 +248,11 @@ Lex skip_if_clause(Preprocessor *pp, size_t depth, int else_clause) {
     case ElseIfDefined:
         lex = lex_next_top(pp);
         if (lex.type == LEX_Identifier) {
-            DefineMacro *macro = get_elem_dht(pp->macro_table, &lex.id);
+            DefineMacro *macro = get_macro(pp, lex.id);
             if (macro) {
                 return pp_lex_next(pp);
             } else {
-                return skip_if_clause(pp, pp->macro_if_depth, else_clause);
+                return skip_if_clause(pp, else_clause);
             }
         } else {
             return (Lex){.type = LEX_Invalid,
@@ -286,9 +262,9 @@ Lex skip_if_clause(Preprocessor *pp, size_t depth, int else_clause) {
     case ElseIfNotDefined:
         lex = lex_next_top(pp);
         if (lex.type == LEX_Identifier) {
-            DefineMacro *macro = get_elem_dht(pp->macro_table, &lex.id);
+            DefineMacro *macro = get_macro(pp, lex.id);
             if (macro) {
-                return skip_if_clause(pp, pp->macro_if_depth, else_clause);
+                return skip_if_clause(pp, else_clause);
             } else {
                 return pp_lex_next(pp);
             }
@@ -301,12 +277,31 @@ Lex skip_if_clause(Preprocessor *pp, size_t depth, int else_clause) {
         pp->macro_if_depth -= 1;
         return pp_lex_next(pp);
     default:
-        return skip_if_clause(pp, depth, else_clause);
+        return skip_if_clause(pp, else_clause);
     }
 }
 
+// Take a #pragma once here, so the file is never included again.
+// Returns 0 for any other pragma, which is left as it is.
+int pragma_once(Preprocessor *pp) {
+    IncludeResource *top = get_top_resc(pp);
+    if (top->type != IncludeFile) {
+        return 0;
+    }
+    Stream *stream = &top->stream;
+    size_t idx = skip_space(stream->start, stream->idx, stream->len, 0);
+    if (memcmp(stream->start + idx, "once", 4) ||
+        skip_id_chars(stream->start, idx, stream->len) != idx + 4) {
+        return 0;
+    }
+    stream->idx = idx + 4;
+    get_file(pp->files, top->file)->once = 1;
+    return 1;
+}
+
 Lex pp_lex_next(Preprocessor *pp) {
     Lex lex = lex_next_top_expand(pp);
+    Span str; // Decoded message of #error and #warning
 
     if (lex.type == LEX_MacroToken) {
         switch (lex.macro) {
@@ -315,12 +310,15 @@ Lex pp_lex_next(Preprocessor *pp) {
                          .span = lex.span,
                          .invalid = ExpectedValidMacro};
         case Include:
-            return macro_include_file(pp);
+        case IncludeNext:
+            return macro_include_file(pp, lex.macro == IncludeNext);
         case Error:
             lex = lex_next_top_expand(pp);
-            if (lex.type == LEX_String) {
-                printf("#error %.*s on line %zu\n", (int)lex.span.len,
-                       lex.span.start, lex.span.row);
+            if (lex.type == LEX_String &&
+                !decode_literal(pp->literals, lex.id, lex.type, &str)) {
+                Position pos = resolve_loc(pp->locations, lex.span.loc);
+                printf("#error %.*s on line %zu\n", (int)str.len - 1,
+                       str.start, pos.row);
                 return (Lex){.type = LEX_Eof};
             } else {
                 return (Lex){.type = LEX_Invalid,
@@ -329,9 +327,11 @@ Lex pp_lex_next(Preprocessor *pp) {
             }
         case Warning:
             lex = lex_next_top_expand(pp);
-            if (lex.type == LEX_String) {
-                printf("#warning %.*s on line %zu\n", (int)lex.span.len,
-                       lex.span.start, lex.span.row);
+            if (lex.type == LEX_String &&
+                !decode_literal(pp->literals, lex.id, lex.type, &str)) {
+                Position pos = resolve_loc(pp->locations, lex.span.loc);
+                printf("#warning %.*s on line %zu\n", (int)str.len - 1,
+                       str.start, pos.row);
                 return pp_lex_next(pp);
             } else {
                 return (Lex){.type = LEX_Invalid,
@@ -343,7 +343,9 @@ Lex pp_lex_next(Preprocessor *pp) {
         case Undefine:
             lex = lex_next_top(pp);
             if (lex.type == LEX_Identifier) {
-                deletecb_elem_dht(pp->macro_table, &lex.id, clean_macro);
+                MacroKey key = macro_key(pp, lex.id);
+                deletecb_hashed_elem_dht(pp->macro_table, &key, macro_key_eq,
+                                         clean_macro);
                 return pp_lex_next(pp);
             } else {
                 return (Lex){.type = LEX_Invalid,
@@ -357,12 +359,12 @@ Lex pp_lex_next(Preprocessor *pp) {
         case IfDefined:
             lex = lex_next_top(pp);
             if (lex.type == LEX_Identifier) {
-                DefineMacro *macro = get_elem_dht(pp->macro_table, &lex.id);
+                DefineMacro *macro = get_macro(pp, lex.id);
                 pp->macro_if_depth += 1;
                 if (macro) {
                     return pp_lex_next(pp);
                 } else {
-                    return skip_if_clause(pp, pp->macro_if_depth, 0);
+                    return skip_if_clause(pp, 0);
                 }
             } else {
                 return (Lex){.type = LEX_Invalid,
@@ -372,10 +374,10 @@ Lex pp_lex_next(Preprocessor *pp) {
         case IfNotDefined:
             lex = lex_next_top(pp);
             if (lex.type == LEX_Identifier) {
-                DefineMacro *macro = get_elem_dht(pp->macro_table, &lex.id);
+                DefineMacro *macro = get_macro(pp, lex.id);
                 pp->macro_if_depth += 1;
                 if (macro) {
-                    return skip_if_clause(pp, pp->macro_if_depth, 0);
+                    return skip_if_clause(pp, 0);
                 } else {
                     return pp_lex_next(pp);
                 }
@@ -389,7 +391,7 @@ Lex pp_lex_next(Preprocessor *pp) {
         case ElseIfDefined:
         case ElseIfNotDefined:
             // NOTE: We can only be here if we took the previous branch
-            return skip_if_clause(pp, pp->macro_if_depth, 1);
+            return skip_if_clause(pp, 1);
         case EndIf:
             pp->macro_if_depth -= 1;
             return pp_lex_next(pp);
@@ -400,6 +402,9 @@ Lex pp_lex_next(Preprocessor *pp) {
             // TODO:
             return lex;
         case Pragma:
+            if (pragma_once(pp)) {
+                return pp_lex_next(pp);
+            }
             // TODO:
             return lex;
         }
@@ -453,6 +458,7 @@ Lex include_macro(Preprocessor *pp, IncludeResource partial) {
         }
     }
 
+    STAT_EXPANSION(partial.mid);
     insert_include_macro(pp, &partial);
 
     // Slightly reworked lex_next_top_expand to avoid infinite recursion bug
@@ -466,59 +472,97 @@ Lex include_macro(Preprocessor *pp, IncludeResource partial) {
     return lex;
 }
 
-int include_file(Preprocessor *pp, String *path) {
-    // If already present and unused, we don't need to allocate again
-    for (size_t i = 0; i < pp->incl_table->length; i++) {
-        IncludeResource *resc = at_elem_vec(pp->incl_table, i);
-        if (resc->type == IncludeFile && !resc->stream.idx &&
-            resc->path->length == path->length &&
-            !memcmp(resc->path->s, path->s, resc->path->length)) {
-            push_elem_vec(&pp->incl_stack, &i);
-            return 0;
-        }
-    }
-
-    FILE *file = fopen(path->s, "r");
-    if (!file) {
-        printf("File \"%.*s\" could not be found\n", (int)path->length,
-               path->s);
-        return 1;
-    }
-
-    struct stat st_buf;
-    fstat(fileno(file), &st_buf);
-
-    char *buf = malloc(st_buf.st_size + 1);
-    size_t bytes = fread(buf, 1, st_buf.st_size, file);
-    fclose(file);
-
-    if (bytes == 0) {
-        free(buf);
-        return 1;
+// Push a cursor over file `idx`, found at `search` in the search path
+void push_file(Preprocessor *pp, size_t idx, size_t search) {
+    // Including it again would only skip its one group
+    File *file = get_file(pp->files, idx);
+    if (file->once || (file->guard != NO_GUARD && get_macro(pp, file->guard))) {
+        STAT_ADD(include_skips, 1);
+        return;
     }
 
-    if (buf[bytes - 1] != '\\') {
-        buf[bytes] = '\n';
+    if (file->resc != SIZE_MAX) {
+        // Its last cursor is reused once done, or another is made over the
+        // same text while it is in use
+        IncludeResource *resc = at_elem_vec(pp->incl_table, file->resc);
+        if (!resc->stream.idx) {
+            STAT_ADD(include_reuses, 1);
+            resc->search = search;
+            push_elem_vec(&pp->incl_stack, &file->resc);
+            return;
+        }
+        STAT_ADD(include_cursors, 1);
     } else {
-        puts("Last character cannot be '\\'");
-        free(buf);
-        return 1;
+        Span name;
+        if (include_guard(&(Stream){.start = file->source.start,
+                                    .len = file->source.len},
+                          &name)) {
+            file->guard = search_id_table(name, pp->id_table);
+        }
     }
 
+    file->resc = pp->incl_table->length;
     push_elem_vec(&pp->incl_table, &(IncludeResource){
                                        .type = IncludeFile,
-                                       .path = path,
-                                       .stream = {.start = buf,
-                                                  .len = bytes,
+                                       .file = idx,
+                                       .search = search,
+                                       .stream = {.start = file->source.start,
+                                                  .len = file->source.len,
+                                                  .base = file->base,
                                                   .idx = 0,
-                                                  .row = 1,
-                                                  .col = 0,
                                                   .macro_line = 0},
                                    });
+    push_elem_vec(&pp->incl_stack, &file->resc);
+}
 
-    size_t id = pp->incl_table->length - 1;
-    push_elem_vec(&pp->incl_stack, &id);
+int include_file(Preprocessor *pp, String *path) {
+    size_t idx;
+    enum source_error error = find_file(pp->files, path->s, path->length - 1,
+                                        pp->locations, &idx);
+    if (error == SourceNotFound) {
+        printf("File \"%.*s\" could not be found\n", (int)path->length,
+               path->s);
+    }
+    delete_str(path);
+    if (error) {
+        return 1;
+    }
+    push_file(pp, idx, NO_SEARCH);
+    return 0;
+}
+
+int include_name(Preprocessor *pp, Span name, int angled, int next) {
+    IncludeResource *top = get_top_resc(pp);
+    next = next && top->search != NO_SEARCH;
+    size_t search = next      ? top->search + 1
+                    : angled ? pp->files->ends[SearchQuote]
+                             : 0;
+
+    size_t idx;
+    enum source_error error = SourceNotFound;
+    if (name.start[0] == '/') {
+        error = find_file(pp->files, name.start, name.len, pp->locations,
+                          &idx);
+        search = NO_SEARCH;
+    } else if (!angled && !next) {
+        size_t dir = get_file(pp->files, top->file)->dir;
+        error = find_in_dir(pp->files, dir, name.start, name.len,
+                            pp->locations, &idx);
+        search = error == SourceNotFound ? search : NO_SEARCH;
+    }
+    if (error == SourceNotFound && search != NO_SEARCH) {
+        error = search_file(pp->files, name.start, name.len, &search,
+                            pp->locations, &idx);
+    }
 
+    if (error == SourceNotFound) {
+        printf("File \"%.*s\" could not be found\n", (int)name.len,
+               name.start);
+    }
+    if (error) {
+        return 1;
+    }
+    push_file(pp, idx, search);
     return 0;
 }
 
@@ -530,12 +574,13 @@ IncludeResource *get_top_resc(Preprocessor *pp) {
     return at_elem_vec(pp->incl_table, idx);
 }
 
-void print_macro_table(Macros *macro_table) {
+void print_macro_table(Macros *macro_table, const Constants *constants,
+                       Locations *locations) {
     Entry entry;
     size_t idx = 0;
     while ((entry = next_elem_dht(macro_table, &idx)).key) {
         DefineMacro *macro = entry.value;
-        printf("#string-id: %zu", *(size_t *)entry.key);
+        printf("#string-id: %zu", ((MacroKey *)entry.key)->mid);
         if (macro->args) {
             printf("\n.args-len: %zu args:", macro->args->length);
             for (size_t i = 0; i < macro->args->length; i++) {
@@ -543,7 +588,7 @@ void print_macro_table(Macros *macro_table) {
             }
             if (macro->lexes) {
                 printf("\n.elems-len: %zu elems:\n", macro->lexes->length);
-                print_lexes(macro->lexes, 0);
+                print_lexes(macro->lexes, constants, locations, 0);
             }
             printf("#\n");
             continue;
@@ -551,7 +596,7 @@ void print_macro_table(Macros *macro_table) {
         if (macro->lexes) {
             if (macro->lexes->length) {
                 printf(" elems-len: %zu elems:\n", macro->lexes->length);
-                print_lexes(macro->lexes, 0);
+                print_lexes(macro->lexes, constants, locations, 0);
             } else {
                 printf(" elems-len: %zu elems: none", macro->lexes->length);
             }
@@ -560,15 +605,14 @@ void print_macro_table(Macros *macro_table) {
     }
 }
 
-void print_incl_table(Includes *incl_table) {
+void print_incl_table(Includes *incl_table, Files *files,
+                      const Constants *constants, Locations *locations) {
     for (size_t i = 0; i < incl_table->length; i++) {
         IncludeResource *resc = at_elem_vec(incl_table, i);
         if (resc->type == IncludeFile) {
-            printf(
-                "<FILE: path: %s base-ptr: %p len: %zu row: %zu col: %zu idx: "
-                "%zu>\n",
-                resc->path->s, resc->stream.start, resc->stream.len,
-                resc->stream.row, resc->stream.col, resc->stream.idx);
+            printf("<FILE: path: %s base-ptr: %p len: %zu base: %u idx: %zu>\n",
+                   get_file(files, resc->file)->path->s, resc->stream.start,
+                   resc->stream.len, resc->stream.base, resc->stream.idx);
         } else if (resc->type == IncludeMacro) {
             printf("<MACRO: mid: %zu token-idx: %zu", resc->mid, resc->idx);
             if (resc->args) {
@@ -577,14 +621,14 @@ void print_incl_table(Includes *incl_table) {
             }
             if (resc->lexes) {
                 printf(" elems-len: %zu elems:\n", resc->lexes->length);
-                print_lexes(resc->lexes, 0);
+                print_lexes(resc->lexes, constants, locations, 0);
             }
             printf(">\n");
         } else if (resc->type == IncludeParameter) {
             printf("<PARAM: mid: %zu token-idx: %zu", resc->mid, resc->idx);
             if (resc->lexes) {
                 printf(" elems-len: %zu elems:\n", resc->lexes->length);
-                print_lexes(resc->lexes, 0);
+                print_lexes(resc->lexes, constants, locations, 0);
             }
             printf(">\n");
         } else {
@@ -628,8 +672,13 @@ Preprocessor *create_pp() {
     Preprocessor *pp = malloc(sizeof(*pp));
     pp->incl_table = create_vec(8, sizeof(IncludeResource));
     pp->incl_stack = create_vec(8, sizeof(size_t));
-    pp->macro_table = create_dht(8, sizeof(size_t), sizeof(DefineMacro));
+    pp->macro_table = create_dht(8, sizeof(MacroKey), sizeof(DefineMacro));
+    pp->files = create_files(8);
     pp->id_table = create_ids(8);
+    pp->literals = create_literals(8);
+    pp->constants = create_constants(8);
+    pp->locations = create_locations(8);
+    pp->pch = (Source){0};
     pp->macro_if_depth = 0;
     return pp;
 }
@@ -639,11 +688,14 @@ void print_pp(Preprocessor *pp) {
     printf("include-stack:\n");
     print_incl_stack(pp->incl_stack);
     printf("include-table:\n");
-    print_incl_table(pp->incl_table);
+    print_incl_table(pp->incl_table, pp->files, pp->constants,
+                     pp->locations);
     printf("defined-macros:\n");
-    print_macro_table(pp->macro_table);
+    print_macro_table(pp->macro_table, pp->constants, pp->locations);
     printf("id-table:\n");
     print_ids(pp->id_table);
+    printf("literals:\n");
+    print_literals(pp->literals);
     printf(")");
 }
 
@@ -651,10 +703,7 @@ void print_pp(Preprocessor *pp) {
 void delete_pp(Preprocessor *pp) {
     for (size_t i = 0; i < pp->incl_table->length; i++) {
         IncludeResource *resc = at_elem_vec(pp->incl_table, i);
-        if (resc->type == IncludeFile) {
-            delete_str(resc->path);
-            free(resc->stream.start);
-        } else if (resc->type == IncludeMacro) {
+        if (resc->type == IncludeMacro) {
             if (resc->args) {
                 delete_args(resc->args);
             }
@@ -662,12 +711,17 @@ void delete_pp(Preprocessor *pp) {
     }
     delete_vec(pp->incl_table);
     delete_vec(pp->incl_stack);
-    delete_vec(pp->id_table);
+    delete_ids(pp->id_table);
+    delete_literals(pp->literals);
+    delete_constants(pp->constants);
+    delete_locations(pp->locations);
     Entry entry;
     size_t idx = 0;
     while ((entry = next_elem_dht(pp->macro_table, &idx)).key) {
         clean_macro(entry.value);
     }
     delete_dht(pp->macro_table);
+    delete_files(pp->files);
+    close_source(&pp->pch);
     free(pp);
 }
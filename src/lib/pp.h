@@ -4,10 +4,11 @@
 #ifndef PP_H
 #define PP_H
 
+#include "files.h"
 #include "got.h"
 #include "lexer.h"
 
-typedef HashTable Macros;    // Mid -> DefineMacro hashtable
+typedef HashTable Macros;    // MacroKey -> DefineMacro hashtable
 typedef Vector Args;         // Each arg is Lexes*
 typedef Vector Includes;     // Actual IncludeResources
 typedef Vector IdsRef;       // Idxs to Ids
@@ -35,6 +36,15 @@ typedef Vector IncludeStack; // Idxs to Includes
  * exhaustable *IncludeResource* for use of the *Preprocessor* to produce
  * the next lex.
  */
+// Key of `Macros`, a mid with the hash of its name kept in Ids,
+// so looking a macro up does not hash again
+typedef struct MacroKey {
+    uint64_t hash;
+    size_t mid;
+} MacroKey;
+
+int macro_key_eq(const void *key, const void *elem_key);
+
 typedef struct DefineMacro {
     IdsRef *args;
     Lexes *lexes; // what to replace with
@@ -48,13 +58,15 @@ enum include_type {
     IncludeFile,
 };
 
-// `path` and `stream.start` must be freed for IncludeFile.
+// An IncludeFile is a cursor over a file owned by `Files`.
 // `lexes` must be freed for IncludeMacro.
 typedef struct IncludeResource {
     enum include_type type;
     union {
         struct {
-            String *path;
+            size_t file;   // Idx in `Files`
+            size_t search; // Where in the search path it was found, or
+                           // NO_SEARCH, for #include_next
             Stream stream;
         };
         struct {
@@ -72,15 +84,29 @@ typedef struct Preprocessor {
     Includes *incl_table;
     IncludeStack *incl_stack;
     Macros *macro_table;
+    Files *files;
     Ids *id_table;
+    Literals *literals;
+    Constants *constants;
+    Locations *locations;
+    Source pch; // Snapshot the tables point into, see pch.h
     size_t macro_if_depth;
     int disabled_if; // Inside non-taken branch
 } Preprocessor;
 
 Lex pp_lex_next(Preprocessor *pp);
 
+// Push a cursor over the file at `path`, which is freed here.
+// Returns 1 if it could not be read.
 int include_file(Preprocessor *pp, String *path);
 
+// Include `name` from the top file. A quoted one is looked for next to it
+// first, then in the search path, which angled ones start past -iquote.
+// With `next`, the search goes on past the directory the top file was
+// found in, as #include_next does.
+// Returns 1 if it could not be found or read.
+int include_name(Preprocessor *pp, Span name, int angled, int next);
+
 Preprocessor *create_pp();
 void print_pp(Preprocessor *pp);
 void delete_pp(Preprocessor *pp);
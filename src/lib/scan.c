@@ -0,0 +1,476 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "scan.h"
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#if defined(__SSE2__) && defined(__GNUC__) &&                                  \
+    (defined(__x86_64__) || defined(__i386__))
+#define SCAN_AVX2
+#include <immintrin.h>
+#endif
+
+size_t skip_space_tail(const char *input, size_t idx, size_t len,
+                       int newlines) {
+    for (; idx < len; idx++) {
+        char c = input[idx];
+        if (c != ' ' && c != '\t' && c != '\r' && (c != '\n' || !newlines)) {
+            break;
+        }
+    }
+    return idx;
+}
+
+size_t find_newline_tail(const char *input, size_t idx, size_t len) {
+    while (idx < len && input[idx] != '\n') {
+        idx += 1;
+    }
+    return idx;
+}
+
+size_t find_quote_or_escape_tail(const char *input, size_t idx, size_t len) {
+    while (idx < len && input[idx] != '"' && input[idx] != '\\') {
+        idx += 1;
+    }
+    return idx;
+}
+
+size_t skip_block_comment_tail(const char *input, size_t idx, size_t len) {
+    for (; idx + 1 < len; idx++) {
+        if (input[idx] == '*' && input[idx + 1] == '/') {
+            return idx + 2;
+        }
+    }
+    return len;
+}
+
+size_t find_splice_tail(const char *input, size_t idx, size_t len) {
+    for (; idx + 1 < len; idx++) {
+        if (input[idx] != '\\') {
+            continue;
+        } else if (input[idx + 1] == '\n') {
+            return idx;
+        } else if (input[idx + 1] == '\r' && idx + 2 < len &&
+                   input[idx + 2] == '\n') {
+            return idx;
+        }
+    }
+    return len;
+}
+
+size_t find_group_stop_tail(const char *input, size_t idx, size_t len) {
+    for (; idx < len; idx++) {
+        char c = input[idx];
+        if (c == '\n' || c == '/' || c == '"' || c == '\'') {
+            break;
+        }
+    }
+    return idx;
+}
+
+size_t skip_id_chars_tail(const char *input, size_t idx, size_t len) {
+    for (; idx < len; idx++) {
+        char c = input[idx];
+        if (!((c | 0x20) >= 'a' && (c | 0x20) <= 'z') &&
+            !(c >= '0' && c <= '9') && c != '_') {
+            break;
+        }
+    }
+    return idx;
+}
+
+#ifdef __SSE2__
+size_t skip_space_sse2(const char *input, size_t idx, size_t len,
+                       int newlines) {
+    const __m128i spacev = _mm_set1_epi8(' ');
+    const __m128i tabv = _mm_set1_epi8('\t');
+    const __m128i crv = _mm_set1_epi8('\r');
+    const __m128i nlv = _mm_set1_epi8('\n');
+    for (; idx + 16 <= len; idx += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(input + idx));
+        uint32_t nl = newlines ? _mm_movemask_epi8(_mm_cmpeq_epi8(v, nlv)) : 0;
+        uint32_t blank = _mm_movemask_epi8(
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, spacev),
+                                      _mm_cmpeq_epi8(v, tabv)),
+                         _mm_cmpeq_epi8(v, crv)));
+        uint32_t stop = ~(blank | nl) & 0xFFFF;
+        if (stop) {
+            return idx + __builtin_ctz(stop);
+        }
+    }
+    return skip_space_tail(input, idx, len, newlines);
+}
+
+size_t find_newline_sse2(const char *input, size_t idx, size_t len) {
+    const __m128i nlv = _mm_set1_epi8('\n');
+    for (; idx + 16 <= len; idx += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(input + idx));
+        uint32_t nl = _mm_movemask_epi8(_mm_cmpeq_epi8(v, nlv));
+        if (nl) {
+            return idx + __builtin_ctz(nl);
+        }
+    }
+    return find_newline_tail(input, idx, len);
+}
+
+size_t find_quote_or_escape_sse2(const char *input, size_t idx, size_t len) {
+    const __m128i quotev = _mm_set1_epi8('"');
+    const __m128i escapev = _mm_set1_epi8('\\');
+    for (; idx + 16 <= len; idx += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(input + idx));
+        uint32_t stop = _mm_movemask_epi8(_mm_or_si128(
+            _mm_cmpeq_epi8(v, quotev), _mm_cmpeq_epi8(v, escapev)));
+        if (stop) {
+            return idx + __builtin_ctz(stop);
+        }
+    }
+    return find_quote_or_escape_tail(input, idx, len);
+}
+
+size_t skip_block_comment_sse2(const char *input, size_t idx, size_t len) {
+    const __m128i starv = _mm_set1_epi8('*');
+    const __m128i slashv = _mm_set1_epi8('/');
+    for (; idx + 17 <= len; idx += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(input + idx));
+        __m128i next = _mm_loadu_si128((const __m128i *)(input + idx + 1));
+        uint32_t end = _mm_movemask_epi8(_mm_and_si128(
+            _mm_cmpeq_epi8(v, starv), _mm_cmpeq_epi8(next, slashv)));
+        if (end) {
+            return idx + __builtin_ctz(end) + 2;
+        }
+    }
+    return skip_block_comment_tail(input, idx, len);
+}
+
+size_t find_splice_sse2(const char *input, size_t idx, size_t len) {
+    const __m128i backslashv = _mm_set1_epi8('\\');
+    const __m128i nlv = _mm_set1_epi8('\n');
+    const __m128i crv = _mm_set1_epi8('\r');
+    for (; idx + 18 <= len; idx += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(input + idx));
+        __m128i next = _mm_loadu_si128((const __m128i *)(input + idx + 1));
+        __m128i after = _mm_loadu_si128((const __m128i *)(input + idx + 2));
+        __m128i crlf = _mm_and_si128(_mm_cmpeq_epi8(next, crv),
+                                     _mm_cmpeq_epi8(after, nlv));
+        uint32_t splice = _mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(v, backslashv),
+                          _mm_or_si128(_mm_cmpeq_epi8(next, nlv), crlf)));
+        if (splice) {
+            return idx + __builtin_ctz(splice);
+        }
+    }
+    return find_splice_tail(input, idx, len);
+}
+
+size_t find_group_stop_sse2(const char *input, size_t idx, size_t len) {
+    const __m128i nlv = _mm_set1_epi8('\n');
+    const __m128i slashv = _mm_set1_epi8('/');
+    const __m128i quotev = _mm_set1_epi8('"');
+    const __m128i apostrophev = _mm_set1_epi8('\'');
+    for (; idx + 16 <= len; idx += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(input + idx));
+        uint32_t stop = _mm_movemask_epi8(
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, nlv),
+                                      _mm_cmpeq_epi8(v, slashv)),
+                         _mm_or_si128(_mm_cmpeq_epi8(v, quotev),
+                                      _mm_cmpeq_epi8(v, apostrophev))));
+        if (stop) {
+            return idx + __builtin_ctz(stop);
+        }
+    }
+    return find_group_stop_tail(input, idx, len);
+}
+
+// Bytes of `v` from `lo` to `hi`, shifted so a signed compare finds them
+__m128i bytes_in_sse2(__m128i v, char lo, char hi) {
+    __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8((char)(0x80 - lo)));
+    return _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(0x80 + hi - lo + 1)));
+}
+
+size_t skip_id_chars_sse2(const char *input, size_t idx, size_t len) {
+    const __m128i casev = _mm_set1_epi8(0x20);
+    const __m128i underscorev = _mm_set1_epi8('_');
+    for (; idx + 16 <= len; idx += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(input + idx));
+        __m128i id = _mm_or_si128(
+            _mm_or_si128(bytes_in_sse2(_mm_or_si128(v, casev), 'a', 'z'),
+                         bytes_in_sse2(v, '0', '9')),
+            _mm_cmpeq_epi8(v, underscorev));
+        uint32_t stop = ~_mm_movemask_epi8(id) & 0xFFFF;
+        if (stop) {
+            return idx + __builtin_ctz(stop);
+        }
+    }
+    return skip_id_chars_tail(input, idx, len);
+}
+#endif // __SSE2__
+
+#ifdef SCAN_AVX2
+__attribute__((target("avx2"))) size_t
+skip_space_avx2(const char *input, size_t idx, size_t len, int newlines) {
+    const __m256i spacev = _mm256_set1_epi8(' ');
+    const __m256i tabv = _mm256_set1_epi8('\t');
+    const __m256i crv = _mm256_set1_epi8('\r');
+    const __m256i nlv = _mm256_set1_epi8('\n');
+    for (; idx + 32 <= len; idx += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(input + idx));
+        uint32_t nl =
+            newlines ? _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nlv)) : 0;
+        uint32_t blank = _mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, spacev),
+                                            _mm256_cmpeq_epi8(v, tabv)),
+                            _mm256_cmpeq_epi8(v, crv)));
+        uint32_t stop = ~(blank | nl);
+        if (stop) {
+            return idx + __builtin_ctz(stop);
+        }
+    }
+    return skip_space_tail(input, idx, len, newlines);
+}
+
+__attribute__((target("avx2"))) size_t
+find_newline_avx2(const char *input, size_t idx, size_t len) {
+    const __m256i nlv = _mm256_set1_epi8('\n');
+    for (; idx + 32 <= len; idx += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(input + idx));
+        uint32_t nl = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nlv));
+        if (nl) {
+            return idx + __builtin_ctz(nl);
+        }
+    }
+    return find_newline_tail(input, idx, len);
+}
+
+__attribute__((target("avx2"))) size_t
+find_quote_or_escape_avx2(const char *input, size_t idx, size_t len) {
+    const __m256i quotev = _mm256_set1_epi8('"');
+    const __m256i escapev = _mm256_set1_epi8('\\');
+    for (; idx + 32 <= len; idx += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(input + idx));
+        uint32_t stop = _mm256_movemask_epi8(_mm256_or_si256(
+            _mm256_cmpeq_epi8(v, quotev), _mm256_cmpeq_epi8(v, escapev)));
+        if (stop) {
+            return idx + __builtin_ctz(stop);
+        }
+    }
+    return find_quote_or_escape_tail(input, idx, len);
+}
+
+__attribute__((target("avx2"))) size_t
+skip_block_comment_avx2(const char *input, size_t idx, size_t len) {
+    const __m256i starv = _mm256_set1_epi8('*');
+    const __m256i slashv = _mm256_set1_epi8('/');
+    for (; idx + 33 <= len; idx += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(input + idx));
+        __m256i next = _mm256_loadu_si256((const __m256i *)(input + idx + 1));
+        uint32_t end = _mm256_movemask_epi8(_mm256_and_si256(
+            _mm256_cmpeq_epi8(v, starv), _mm256_cmpeq_epi8(next, slashv)));
+        if (end) {
+            return idx + __builtin_ctz(end) + 2;
+        }
+    }
+    return skip_block_comment_tail(input, idx, len);
+}
+
+__attribute__((target("avx2"))) size_t
+find_splice_avx2(const char *input, size_t idx, size_t len) {
+    const __m256i backslashv = _mm256_set1_epi8('\\');
+    const __m256i nlv = _mm256_set1_epi8('\n');
+    const __m256i crv = _mm256_set1_epi8('\r');
+    for (; idx + 34 <= len; idx += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(input + idx));
+        __m256i next = _mm256_loadu_si256((const __m256i *)(input + idx + 1));
+        __m256i after = _mm256_loadu_si256((const __m256i *)(input + idx + 2));
+        __m256i crlf = _mm256_and_si256(_mm256_cmpeq_epi8(next, crv),
+                                        _mm256_cmpeq_epi8(after, nlv));
+        __m256i nl = _mm256_or_si256(_mm256_cmpeq_epi8(next, nlv), crlf);
+        uint32_t splice = _mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(v, backslashv), nl));
+        if (splice) {
+            return idx + __builtin_ctz(splice);
+        }
+    }
+    return find_splice_tail(input, idx, len);
+}
+
+__attribute__((target("avx2"))) size_t
+find_group_stop_avx2(const char *input, size_t idx, size_t len) {
+    const __m256i nlv = _mm256_set1_epi8('\n');
+    const __m256i slashv = _mm256_set1_epi8('/');
+    const __m256i quotev = _mm256_set1_epi8('"');
+    const __m256i apostrophev = _mm256_set1_epi8('\'');
+    for (; idx + 32 <= len; idx += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(input + idx));
+        __m256i quotes = _mm256_or_si256(_mm256_cmpeq_epi8(v, quotev),
+                                         _mm256_cmpeq_epi8(v, apostrophev));
+        uint32_t stop = _mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, nlv),
+                                            _mm256_cmpeq_epi8(v, slashv)),
+                            quotes));
+        if (stop) {
+            return idx + __builtin_ctz(stop);
+        }
+    }
+    return find_group_stop_tail(input, idx, len);
+}
+
+__attribute__((target("avx2"))) __m256i bytes_in_avx2(__m256i v, char lo,
+                                                      char hi) {
+    __m256i shifted =
+        _mm256_add_epi8(v, _mm256_set1_epi8((char)(0x80 - lo)));
+    return _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(0x80 + hi - lo + 1)),
+                             shifted);
+}
+
+__attribute__((target("avx2"))) size_t
+skip_id_chars_avx2(const char *input, size_t idx, size_t len) {
+    const __m256i casev = _mm256_set1_epi8(0x20);
+    const __m256i underscorev = _mm256_set1_epi8('_');
+    for (; idx + 32 <= len; idx += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(input + idx));
+        __m256i id = _mm256_or_si256(
+            _mm256_or_si256(
+                bytes_in_avx2(_mm256_or_si256(v, casev), 'a', 'z'),
+                bytes_in_avx2(v, '0', '9')),
+            _mm256_cmpeq_epi8(v, underscorev));
+        uint32_t stop = ~(uint32_t)_mm256_movemask_epi8(id);
+        if (stop) {
+            return idx + __builtin_ctz(stop);
+        }
+    }
+    return skip_id_chars_tail(input, idx, len);
+}
+#endif // SCAN_AVX2
+
+#ifndef __SSE2__
+#define skip_space_scalar skip_space_tail
+#define skip_block_comment_scalar skip_block_comment_tail
+#define find_newline_scalar find_newline_tail
+#define find_quote_or_escape_scalar find_quote_or_escape_tail
+#define find_splice_scalar find_splice_tail
+#define find_group_stop_scalar find_group_stop_tail
+#define skip_id_chars_scalar skip_id_chars_tail
+#endif
+
+// Picked on the first call, based on what the CPU supports
+size_t skip_space_pick(const char *input, size_t idx, size_t len,
+                       int newlines);
+size_t find_newline_pick(const char *input, size_t idx, size_t len);
+size_t find_quote_or_escape_pick(const char *input, size_t idx, size_t len);
+size_t skip_block_comment_pick(const char *input, size_t idx, size_t len);
+size_t find_splice_pick(const char *input, size_t idx, size_t len);
+size_t find_group_stop_pick(const char *input, size_t idx, size_t len);
+size_t skip_id_chars_pick(const char *input, size_t idx, size_t len);
+
+size_t (*skip_space_impl)(const char *, size_t, size_t,
+                          int) = skip_space_pick;
+size_t (*find_newline_impl)(const char *, size_t, size_t) = find_newline_pick;
+size_t (*find_quote_or_escape_impl)(const char *, size_t,
+                                    size_t) = find_quote_or_escape_pick;
+size_t (*skip_block_comment_impl)(const char *, size_t,
+                                  size_t) = skip_block_comment_pick;
+size_t (*find_splice_impl)(const char *, size_t, size_t) = find_splice_pick;
+size_t (*find_group_stop_impl)(const char *, size_t,
+                               size_t) = find_group_stop_pick;
+size_t (*skip_id_chars_impl)(const char *, size_t,
+                             size_t) = skip_id_chars_pick;
+
+void pick_scan_impl() {
+#ifdef SCAN_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        skip_space_impl = skip_space_avx2;
+        find_newline_impl = find_newline_avx2;
+        find_quote_or_escape_impl = find_quote_or_escape_avx2;
+        skip_block_comment_impl = skip_block_comment_avx2;
+        find_splice_impl = find_splice_avx2;
+        find_group_stop_impl = find_group_stop_avx2;
+        skip_id_chars_impl = skip_id_chars_avx2;
+        return;
+    }
+#endif
+#ifdef __SSE2__
+    skip_space_impl = skip_space_sse2;
+    find_newline_impl = find_newline_sse2;
+    find_quote_or_escape_impl = find_quote_or_escape_sse2;
+    skip_block_comment_impl = skip_block_comment_sse2;
+    find_splice_impl = find_splice_sse2;
+    find_group_stop_impl = find_group_stop_sse2;
+    skip_id_chars_impl = skip_id_chars_sse2;
+#else
+    skip_space_impl = skip_space_scalar;
+    find_newline_impl = find_newline_scalar;
+    find_quote_or_escape_impl = find_quote_or_escape_scalar;
+    skip_block_comment_impl = skip_block_comment_scalar;
+    find_splice_impl = find_splice_scalar;
+    find_group_stop_impl = find_group_stop_scalar;
+    skip_id_chars_impl = skip_id_chars_scalar;
+#endif
+}
+
+size_t skip_space_pick(const char *input, size_t idx, size_t len,
+                       int newlines) {
+    pick_scan_impl();
+    return skip_space_impl(input, idx, len, newlines);
+}
+
+size_t find_newline_pick(const char *input, size_t idx, size_t len) {
+    pick_scan_impl();
+    return find_newline_impl(input, idx, len);
+}
+
+size_t find_quote_or_escape_pick(const char *input, size_t idx, size_t len) {
+    pick_scan_impl();
+    return find_quote_or_escape_impl(input, idx, len);
+}
+
+size_t skip_block_comment_pick(const char *input, size_t idx, size_t len) {
+    pick_scan_impl();
+    return skip_block_comment_impl(input, idx, len);
+}
+
+size_t find_splice_pick(const char *input, size_t idx, size_t len) {
+    pick_scan_impl();
+    return find_splice_impl(input, idx, len);
+}
+
+size_t find_group_stop_pick(const char *input, size_t idx, size_t len) {
+    pick_scan_impl();
+    return find_group_stop_impl(input, idx, len);
+}
+
+size_t skip_id_chars_pick(const char *input, size_t idx, size_t len) {
+    pick_scan_impl();
+    return skip_id_chars_impl(input, idx, len);
+}
+
+size_t skip_space(const char *input, size_t idx, size_t len, int newlines) {
+    return skip_space_impl(input, idx, len, newlines);
+}
+
+size_t find_newline(const char *input, size_t idx, size_t len) {
+    return find_newline_impl(input, idx, len);
+}
+
+size_t find_quote_or_escape(const char *input, size_t idx, size_t len) {
+    return find_quote_or_escape_impl(input, idx, len);
+}
+
+size_t skip_block_comment(const char *input, size_t idx, size_t len) {
+    return skip_block_comment_impl(input, idx, len);
+}
+
+size_t find_splice(const char *input, size_t idx, size_t len) {
+    return find_splice_impl(input, idx, len);
+}
+
+size_t find_group_stop(const char *input, size_t idx, size_t len) {
+    return find_group_stop_impl(input, idx, len);
+}
+
+size_t skip_id_chars(const char *input, size_t idx, size_t len) {
+    return skip_id_chars_impl(input, idx, len);
+}
@@ -0,0 +1,39 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef SCAN_H_
+#define SCAN_H_
+
+#include <stddef.h>
+
+// SIMD scanning kernels for the lexer.
+// SSE2 is assumed like in got.h, AVX2 is used instead if the CPU has it.
+// None of the kernels read at or past `len`.
+
+// Skip ' ', '\t' and '\r', as well as '\n' if `newlines` is set.
+// Idx of the first byte not skipped.
+size_t skip_space(const char *input, size_t idx, size_t len, int newlines);
+
+// Idx of the next '\n' at or after `idx`, `len` if there is none.
+size_t find_newline(const char *input, size_t idx, size_t len);
+
+// Idx of the next '"' or '\\' at or after `idx`, `len` if there is none.
+size_t find_quote_or_escape(const char *input, size_t idx, size_t len);
+
+// Skip a block comment body starting after its `/*` up to and including `*/`.
+// Idx after the `*/`, `len` if unterminated.
+size_t skip_block_comment(const char *input, size_t idx, size_t len);
+
+// Idx of the next '\\' followed by '\n' or "\r\n" at or after `idx`,
+// `len` if there is none.
+size_t find_splice(const char *input, size_t idx, size_t len);
+
+// Idx of the next '\n', '/', '"' or '\'' at or after `idx`, `len` if there is
+// none. Anything else cannot end a line of a skipped group early or late.
+size_t find_group_stop(const char *input, size_t idx, size_t len);
+
+// Skip ASCII letters, digits and '_'.
+// Idx of the first byte not skipped.
+size_t skip_id_chars(const char *input, size_t idx, size_t len);
+
+#endif // SCAN_H_
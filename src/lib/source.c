@@ -0,0 +1,168 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "source.h"
+#include "scan.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Below this, read() beats setting up and tearing down a mapping
+#define SOURCE_MAP_MIN (16 * 1024)
+
+// Map `len` bytes of `fd`, then '\n' and zeroes up to the padding.
+// The pages past the file are anonymous, so no byte of the padding is
+// past the end of the file, which would fault.
+int map_source_fd(int fd, size_t len, Source *source) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t file_pages = (len + page - 1) & ~(page - 1);
+    size_t mapped = (len + 1 + SOURCE_PADDING + page - 1) & ~(page - 1);
+
+    char *start = mmap(0, mapped, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (start == MAP_FAILED) {
+        return 1;
+    }
+
+    // Private, so only the tail page gets copied for the newline
+    if (mmap(start, file_pages, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+             fd, 0) == MAP_FAILED) {
+        munmap(start, mapped);
+        return 1;
+    }
+    start[len] = '\n';
+    mprotect(start, mapped, PROT_READ);
+    madvise(start, file_pages, MADV_SEQUENTIAL);
+
+    *source = (Source){start, len, mapped};
+    return 0;
+}
+
+// Read until EOF, for pipes and files too small to be worth mapping
+int read_source_fd(int fd, size_t hint, Source *source) {
+    // One spare byte, so the read that sees EOF is never empty
+    size_t cap = hint + 2 + SOURCE_PADDING, len = 0;
+    char *start = malloc(cap);
+    if (!start) {
+        return 1;
+    }
+
+    for (;;) {
+        if (cap - len <= 1 + SOURCE_PADDING) {
+            cap *= 2;
+            char *grown = realloc(start, cap);
+            if (!grown) {
+                free(start);
+                return 1;
+            }
+            start = grown;
+        }
+
+        ssize_t bytes = read(fd, start + len, cap - len - 1 - SOURCE_PADDING);
+        if (bytes < 0) {
+            free(start);
+            return 1;
+        } else if (!bytes) {
+            break;
+        }
+        len += bytes;
+    }
+
+    start[len] = '\n';
+    memset(start + len + 1, 0, SOURCE_PADDING);
+    *source = (Source){start, len, 0};
+    return 0;
+}
+
+enum source_error open_source(const char *path, Source *source) {
+    int fd = strcmp(path, "-") ? open(path, O_RDONLY) : STDIN_FILENO;
+    if (fd < 0) {
+        return SourceNotFound;
+    }
+
+    struct stat st_buf;
+    if (fstat(fd, &st_buf)) {
+        close(fd);
+        return SourceUnreadable;
+    }
+
+    int failed = 1;
+    if (S_ISREG(st_buf.st_mode) && st_buf.st_size >= SOURCE_MAP_MIN) {
+        failed = map_source_fd(fd, st_buf.st_size, source);
+    }
+    if (failed) {
+        size_t hint = S_ISREG(st_buf.st_mode) ? st_buf.st_size : 4096;
+        failed = read_source_fd(fd, hint, source);
+    }
+
+    if (fd != STDIN_FILENO) {
+        close(fd);
+    }
+    if (failed) {
+        return SourceUnreadable;
+    }
+    source->id = (FileId){st_buf.st_dev, st_buf.st_ino};
+    return SourceOk;
+}
+
+enum source_error file_id(const char *path, FileId *id) {
+    struct stat st_buf;
+    if (strcmp(path, "-") ? stat(path, &st_buf)
+                          : fstat(STDIN_FILENO, &st_buf)) {
+        return SourceNotFound;
+    }
+    *id = (FileId){st_buf.st_dev, st_buf.st_ino};
+    return SourceOk;
+}
+
+void close_source(Source *source) {
+    if (source->mapped) {
+        munmap(source->start, source->mapped);
+    } else {
+        free(source->start);
+    }
+    *source = (Source){0};
+}
+
+enum source_error splice_source(Source *source, Vector **splices) {
+    *splices = 0;
+    const char *input = source->start;
+    size_t len = source->len;
+    size_t idx = find_splice(input, 0, len);
+    if (idx == len) {
+        return SourceOk;
+    } else if (len >= UINT32_MAX) {
+        return SourceUnreadable;
+    }
+
+    // Splicing only shrinks the text
+    char *start = malloc(len + 1 + SOURCE_PADDING);
+    Vector *found = create_vec(16, sizeof(Splice));
+    if (!start || !found) {
+        free(start);
+        free(found);
+        return SourceUnreadable;
+    }
+
+    size_t spliced = 0, from = 0;
+    while (idx < len) {
+        memcpy(start + spliced, input + from, idx - from);
+        spliced += idx - from;
+        from = idx + (input[idx + 1] == '\r' ? 3 : 2);
+        push_elem_vec(&found, &(Splice){spliced, from - spliced});
+        idx = find_splice(input, from, len);
+    }
+    memcpy(start + spliced, input + from, len - from);
+    spliced += len - from;
+
+    start[spliced] = '\n';
+    memset(start + spliced + 1, 0, SOURCE_PADDING);
+    FileId id = source->id;
+    close_source(source);
+    *source = (Source){start, spliced, 0, id};
+    *splices = found;
+    return SourceOk;
+}
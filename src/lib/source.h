@@ -0,0 +1,59 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef SOURCE_H_
+#define SOURCE_H_
+
+#include "vec.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Source buffers for the lexer.
+// Regular files past a few pages are mapped, everything else is read.
+// Either way `start[len]` is '\n', followed by zeroes up to at least
+// SOURCE_PADDING bytes past `len`, so kernels may load whole vectors there.
+
+#define SOURCE_PADDING 64
+
+// Which file it is, the same through symlinks and relative paths
+typedef struct FileId {
+    uint64_t dev;
+    uint64_t ino;
+} FileId;
+
+typedef struct Source {
+    char *start;
+    size_t len;
+    size_t mapped; // Length of the mapping, 0 if malloced
+    FileId id;     // 0 if it is not from a file
+} Source;
+
+enum source_error {
+    SourceOk = 0,
+    SourceNotFound,
+    SourceUnreadable,
+};
+
+// Open `path`, or standard input if it is "-".
+enum source_error open_source(const char *path, Source *source);
+
+void close_source(Source *source);
+
+// FileId of `path`, or of standard input if it is "-", without opening it
+enum source_error file_id(const char *path, FileId *id);
+
+// A backslash and newline, or "\r\n", joined away before `offset` in the
+// spliced text. `removed` counts the bytes of every splice up to this one,
+// so an offset maps back to the file by adding it.
+typedef struct Splice {
+    uint32_t offset;
+    uint32_t removed;
+} Splice;
+
+// Translation phases 1 and 2: join lines ending in a backslash.
+// Most files have no splices and are left as they are, without a copy.
+// Otherwise `source` is replaced by a spliced copy with the same padding,
+// and `splices` gets a vector of them in order, 0 is left there if none.
+enum source_error splice_source(Source *source, Vector **splices);
+
+#endif // SOURCE_H_
@@ -0,0 +1,188 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "stats.h"
+#include "lexer.h"
+#include <stdio.h>
+
+#ifdef DFCC_STATS
+
+// Macros with the most expansions that are printed
+#define STATS_TOP_MACROS 10
+
+Stats dfcc_stats;
+
+const char *const token_names[] = {
+    [LEX_Invalid] = "Invalid",
+    [LEX_Eof] = "Eof",
+    [LEX_Comment] = "Comment",
+    [LEX_Keyword] = "Keyword",
+    [LEX_Identifier] = "Identifier",
+    [LEX_String] = "String",
+    [LEX_StringU8] = "StringU8",
+    [LEX_StringU16] = "StringU16",
+    [LEX_StringU32] = "StringU32",
+    [LEX_StringWide] = "StringWide",
+    [LEX_MacroToken] = "MacroToken",
+    [LEX_MacroEndToken] = "MacroEndToken",
+    [LEX_ConstantUnsignedLongLong] = "ConstantUnsignedLongLong",
+    [LEX_ConstantUnsignedLong] = "ConstantUnsignedLong",
+    [LEX_ConstantUnsignedBitPrecise] = "ConstantUnsignedBitPrecise",
+    [LEX_ConstantUnsigned] = "ConstantUnsigned",
+    [LEX_ConstantLongLong] = "ConstantLongLong",
+    [LEX_ConstantLong] = "ConstantLong",
+    [LEX_ConstantBitPrecise] = "ConstantBitPrecise",
+    [LEX_Constant] = "Constant",
+    [LEX_ConstantFloat] = "ConstantFloat",
+    [LEX_ConstantDouble] = "ConstantDouble",
+    [LEX_ConstantLongDouble] = "ConstantLongDouble",
+    [LEX_ConstantDecimal32] = "ConstantDecimal32",
+    [LEX_ConstantDecimal64] = "ConstantDecimal64",
+    [LEX_ConstantDecimal128] = "ConstantDecimal128",
+    [LEX_ConstantChar] = "ConstantChar",
+    [LEX_ConstantCharU8] = "ConstantCharU8",
+    [LEX_ConstantCharU16] = "ConstantCharU16",
+    [LEX_ConstantCharU32] = "ConstantCharU32",
+    [LEX_ConstantCharWide] = "ConstantCharWide",
+    [LEX_LBracket] = "LBracket",
+    [LEX_RBracket] = "RBracket",
+    [LEX_LParen] = "LParen",
+    [LEX_RParen] = "RParen",
+    [LEX_LSquigly] = "LSquigly",
+    [LEX_RSquigly] = "RSquigly",
+    [LEX_Dot] = "Dot",
+    [LEX_Arrow] = "Arrow",
+    [LEX_PlusPlus] = "PlusPlus",
+    [LEX_MinusMinus] = "MinusMinus",
+    [LEX_Et] = "Et",
+    [LEX_Star] = "Star",
+    [LEX_Plus] = "Plus",
+    [LEX_Minus] = "Minus",
+    [LEX_Tilde] = "Tilde",
+    [LEX_Exclamation] = "Exclamation",
+    [LEX_Slash] = "Slash",
+    [LEX_Percent] = "Percent",
+    [LEX_LeftLeft] = "LeftLeft",
+    [LEX_RightRight] = "RightRight",
+    [LEX_Left] = "Left",
+    [LEX_Right] = "Right",
+    [LEX_LeftEqual] = "LeftEqual",
+    [LEX_RightEqual] = "RightEqual",
+    [LEX_EqualEqual] = "EqualEqual",
+    [LEX_ExclamationEqual] = "ExclamationEqual",
+    [LEX_Caret] = "Caret",
+    [LEX_Pipe] = "Pipe",
+    [LEX_EtEt] = "EtEt",
+    [LEX_PipePipe] = "PipePipe",
+    [LEX_Question] = "Question",
+    [LEX_Colon] = "Colon",
+    [LEX_ColonColon] = "ColonColon",
+    [LEX_Semicolon] = "Semicolon",
+    [LEX_DotDotDot] = "DotDotDot",
+    [LEX_Equal] = "Equal",
+    [LEX_StarEqual] = "StarEqual",
+    [LEX_SlashEqual] = "SlashEqual",
+    [LEX_PercentEqual] = "PercentEqual",
+    [LEX_PlusEqual] = "PlusEqual",
+    [LEX_MinusEqual] = "MinusEqual",
+    [LEX_LeftLeftEqual] = "LeftLeftEqual",
+    [LEX_RightRightEqual] = "RightRightEqual",
+    [LEX_EtEqual] = "EtEqual",
+    [LEX_CaretEqual] = "CaretEqual",
+    [LEX_PipeEqual] = "PipeEqual",
+    [LEX_Comma] = "Comma",
+    [LEX_Hash] = "Hash",
+    [LEX_HashHash] = "HashHash",
+};
+
+void count_expansion(size_t mid) {
+    if (mid >= dfcc_stats.macro_ids) {
+        size_t ids = (mid + 1) * 3 / 2 + 16;
+        uint64_t *counts =
+            realloc(dfcc_stats.macro_expansions, ids * sizeof(uint64_t));
+        if (!counts) {
+            return;
+        }
+        for (size_t i = dfcc_stats.macro_ids; i < ids; i++) {
+            counts[i] = 0;
+        }
+        dfcc_stats.macro_expansions = counts;
+        dfcc_stats.macro_ids = ids;
+    }
+    dfcc_stats.expansions += 1;
+    dfcc_stats.macro_expansions[mid] += 1;
+}
+
+// Most expanded first, then by id
+int by_expansions(const void *a, const void *b) {
+    uint64_t x = dfcc_stats.macro_expansions[*(const size_t *)a];
+    uint64_t y = dfcc_stats.macro_expansions[*(const size_t *)b];
+    if (x != y) {
+        return x < y ? 1 : -1;
+    }
+    return *(const size_t *)a < *(const size_t *)b ? -1 : 1;
+}
+
+double ratio(uint64_t a, uint64_t b) { return b ? (double)a / b : 0; }
+
+int print_stats(const Ids *id_table) {
+    const Stats *s = &dfcc_stats;
+    uint64_t tokens = 0;
+    for (size_t i = 0; i < 256; i++) {
+        tokens += s->tokens[i];
+    }
+    printf("tokens: %llu\n", (unsigned long long)tokens);
+    for (size_t i = 0; i < sizeof(token_names) / sizeof(*token_names); i++) {
+        if (s->tokens[i]) {
+            printf("  %-28s %12llu %6.2f%%\n", token_names[i],
+                   (unsigned long long)s->tokens[i],
+                   100 * ratio(s->tokens[i], tokens));
+        }
+    }
+
+    printf("id lookups: %llu, hits %.2f%%\n",
+           (unsigned long long)s->id_lookups,
+           100 * ratio(s->id_hits, s->id_lookups));
+    printf("table lookups: %llu, %.2f groups and %.2f keys compared each\n",
+           (unsigned long long)s->table_lookups,
+           ratio(s->table_groups, s->table_lookups),
+           ratio(s->table_compares, s->table_lookups));
+
+    printf("macro expansions: %llu\n", (unsigned long long)s->expansions);
+    size_t *mids = malloc(s->macro_ids * sizeof(size_t));
+    size_t count = 0;
+    for (size_t i = 0; mids && i < s->macro_ids; i++) {
+        if (s->macro_expansions[i]) {
+            mids[count++] = i;
+        }
+    }
+    if (mids) {
+        qsort(mids, count, sizeof(size_t), by_expansions);
+    }
+    for (size_t i = 0; i < count && i < STATS_TOP_MACROS; i++) {
+        Span *name = at_elem_vec(id_table->spans, mids[i]);
+        printf("  %-28.*s %12llu\n", (int)name->len, name->start,
+               (unsigned long long)s->macro_expansions[mids[i]]);
+    }
+    free(mids);
+
+    printf("includes: %llu opened, %llu skipped by guard or once, "
+           "%llu reused, %llu nested, %llu paths stat'ed\n",
+           (unsigned long long)s->include_opens,
+           (unsigned long long)s->include_skips,
+           (unsigned long long)s->include_reuses,
+           (unsigned long long)s->include_cursors,
+           (unsigned long long)s->include_stats);
+    printf("parser: %llu saves, %llu backtracks\n",
+           (unsigned long long)s->saves, (unsigned long long)s->backtracks);
+    return 0;
+}
+
+#else
+
+int print_stats(const Ids *id_table) {
+    (void)id_table;
+    return 1;
+}
+
+#endif
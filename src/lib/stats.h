@@ -0,0 +1,64 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Counters on the hot paths, to see where the time goes.
+// Only built with DFCC_STATS, see build.scm. Without it every STAT_* is
+// empty, so nothing is counted and nothing is linked in.
+
+struct Ids;
+
+#ifdef DFCC_STATS
+
+typedef struct Stats {
+    uint64_t tokens[256]; // By enum lex_type
+    uint64_t id_lookups;
+    uint64_t id_hits;
+
+    // Lookups of any table in got.c, with the groups they probed and the
+    // keys they compared
+    uint64_t table_lookups;
+    uint64_t table_groups;
+    uint64_t table_compares;
+
+    uint64_t expansions;
+    uint64_t *macro_expansions; // By macro id, up to `macro_ids`
+    size_t macro_ids;
+
+    uint64_t include_opens;   // Files read, each only once
+    uint64_t include_skips;   // By their guard or #pragma once
+    uint64_t include_reuses;  // Served by a cursor done with
+    uint64_t include_cursors; // Another cursor over a file in use
+    uint64_t include_stats;   // Paths asked of the file system
+
+    uint64_t saves;
+    uint64_t backtracks;
+} Stats;
+
+extern Stats dfcc_stats;
+
+// Relaxed, as the lexer counts from several threads
+#define STAT_ADD(field, n)                                                     \
+    __atomic_fetch_add(&dfcc_stats.field, (n), __ATOMIC_RELAXED)
+
+#define STAT_EXPANSION(mid) count_expansion(mid)
+
+void count_expansion(size_t mid);
+
+#else
+
+#define STAT_ADD(field, n) ((void)0)
+#define STAT_EXPANSION(mid) ((void)0)
+
+#endif
+
+// Print the counters, macros named from `id_table`.
+// Returns 1 if dfcc was built without them.
+int print_stats(const struct Ids *id_table);
+
+#endif // STATS_H_
@@ -37,6 +37,31 @@ uint32_t push_elem_vec(Vector **v, const void *value) {
     return 1;
 }
 
+uint32_t push_slice_vec(Vector **v, const void *values, size_t count) {
+    if (!count) {
+        return 1;
+    }
+
+    if ((*v)->length + count > (*v)->capacity) {
+        size_t new_len = (*v)->length + count;
+        size_t new_capacity = (new_len < 4) ? 4 : ((new_len * 3) / 2);
+        Vector *new_v =
+            realloc(*v, sizeof(Vector) + new_capacity * (*v)->value_size);
+        if (!new_v) {
+            return 0;
+        } else {
+            *v = new_v;
+            (*v)->capacity = new_capacity;
+        }
+    }
+
+    memcpy((*v)->v + (*v)->length * (*v)->value_size, values,
+           count * (*v)->value_size);
+    (*v)->length += count;
+
+    return 1;
+}
+
 void *peek_elem_vec(Vector *v) {
     return (void *)(v->v + v->value_size * (v->length - 1));
 }
@@ -22,6 +22,9 @@ Vector *create_vec(size_t len, size_t value_size);
 // Push element, grows with *3/2, ups to 3 beforehand if less than 4
 uint32_t push_elem_vec(Vector **v, const void *value);
 
+// push_elem, just in a single batch of `count` values
+uint32_t push_slice_vec(Vector **v, const void *values, size_t count);
+
 // Unchecked peek, returns the address, must contain more than 0 elements
 void *peek_elem_vec(Vector *v);
 
@@ -0,0 +1,29 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef XID_H_
+#define XID_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Unicode in identifiers, as C23 takes it from UAX #31.
+// XID_Start and XID_Continue come from a two level table generated from
+// Unicode 14.0, looked up only past ASCII, which the lexer handles itself.
+
+// If `c` may start an identifier, for `c` past ASCII
+int xid_start(uint32_t c);
+
+// If `c` may continue an identifier, for `c` past ASCII
+int xid_continue(uint32_t c);
+
+// Decode the UTF-8 sequence at `input`, reading no more than `len` bytes.
+// Returns its length with the code point in `c`, 0 if it is malformed,
+// overlong or a surrogate.
+size_t decode_utf8(const char *input, size_t len, uint32_t *c);
+
+// Encode `c` into `output`, which has room for 4 bytes.
+// Returns the length.
+size_t encode_utf8(uint32_t c, char *output);
+
+#endif // XID_H_
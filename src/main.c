@@ -2,21 +2,83 @@
    License, v. 2.0. If a copy of the MPL was not distributed with this
    file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include "lib/parser.h"
+#include "lib/pch.h"
+#include "lib/stats.h"
 #include <limits.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/stat.h>
 
+// Searched after -I and -isystem, unless -nostdinc.
+// Only the multiarch one of the host, as headers installed for cross
+// compiling must not stand in for its own. Those that do not exist are
+// left out.
+const char *const default_include_dirs[] = {
+    "/usr/local/include",
+#if defined(__x86_64__)
+    "/usr/include/x86_64-linux-gnu",
+#elif defined(__aarch64__)
+    "/usr/include/aarch64-linux-gnu",
+#endif
+    "/usr/include",
+};
+
 int main(int argc, char *argv[]) {
-    if (argc < 2) {
+    Files *files = create_files(8);
+    const char *emit_pch_path = 0, *pch_path = 0;
+    int stats = 0, nostdinc = 0, first = 1;
+    for (; first < argc; first++) {
+        const char *arg = argv[first];
+        if (!strcmp(arg, "--stats")) {
+            stats = 1;
+        } else if (!strcmp(arg, "--emit-pch") && first + 1 < argc) {
+            emit_pch_path = argv[++first];
+        } else if (!strcmp(arg, "--include-pch") && first + 1 < argc) {
+            pch_path = argv[++first];
+        } else if (!strcmp(arg, "-nostdinc")) {
+            nostdinc = 1;
+        } else if (!strncmp(arg, "-I", 2) && (arg[2] || first + 1 < argc)) {
+            add_search_dir(files, arg[2] ? arg + 2 : argv[++first],
+                           SearchAngled);
+        } else if (!strcmp(arg, "-isystem") && first + 1 < argc) {
+            add_search_dir(files, argv[++first], SearchSystem);
+        } else if (!strcmp(arg, "-iquote") && first + 1 < argc) {
+            add_search_dir(files, argv[++first], SearchQuote);
+        } else {
+            break;
+        }
+    }
+    if (first >= argc) {
         puts("Expected a file as input");
+        delete_files(files);
         return 1;
     }
-    String *path = from_cstr(argv[1]);
-    Parser *parser = create_parser(path);
+    size_t defaults =
+        sizeof(default_include_dirs) / sizeof(default_include_dirs[0]);
+    for (size_t i = 0; !nostdinc && i < defaults; i++) {
+        add_search_dir(files, default_include_dirs[i], SearchDefault);
+    }
+
+    String *path = from_cstr(argv[first]);
+    Parser *parser = create_parser(files, pch_path, path);
+    if (!parser) {
+        return 1;
+    } else if (emit_pch_path) {
+        // The file is a header to snapshot, not parsed here
+        int error = emit_pch(&parser->pp, emit_pch_path);
+        if (error) {
+            printf("PCH \"%s\" could not be written\n", emit_pch_path);
+        }
+        delete_parser(parser);
+        return error;
+    }
     Ast ast = parse(parser);
 
-    print_ast(ast, 0);
+    print_ast(ast, parser->pp.locations, 0);
     print_parser(parser);
+    if (stats && print_stats(parser->pp.id_table)) {
+        puts("Built without stats, see build.scm");
+    }
 
     // delete_ast
     delete_parser(parser);